@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef BLOCKDATA_H
+#define BLOCKDATA_H
+
+#include <QTextBlock>
+
+namespace fpad {
+
+/* Information about the text of a block, which is updated only when the
+   block is changed (-> TextEdit::updateBlockData()), so that painting
+   doesn't need to extract and scan the block text. */
+class BlockData : public QTextBlockUserData
+{
+public:
+    BlockData() :
+        rtl (false),
+        asciiOnly (true),
+        latin1Only (true),
+        matched (false),
+        marks (0),
+        editGeneration (-1),
+        columns (0),
+        tabCount (0) {}
+
+    bool rtl; // the direction of the text
+    bool asciiOnly;
+    bool latin1Only;
+    /* the scrollbar overview (-> TextEdit::updateOverview()) */
+    bool matched; // has a match of the overview search
+    quint8 marks; // the VScrollBar::OverviewMark flags counted in the bins
+    int editGeneration; // the save generation of the editor when it was changed
+    int columns; // the display width, with tabs expanded
+    int tabCount;
+};
+
+}
+
+#endif // BLOCKDATA_H
@@ -28,8 +28,13 @@ Config::Config():
     isMaxed_ (false),
     isFull_ (false),
     saveUnmodified_ (false),
+    backgroundRelayout_ (true),
     maxSHSize_ (2),
     textTabSize_(8),
+    undoBudget_ (256),
+    totalUndoBudget_ (1024),
+    hibernateAfter_ (30),
+    hibernateMemory_ (2048),
     winSize_ (QSize (700, 500)),
     startSize_ (QSize (700, 500)),
     winPos_ (QPoint (0, 0)),
@@ -87,6 +92,11 @@ void Config::readConfig()
     maxSHSize_ = qBound (1, settings.value ("maxSHSize", 2).toInt(), 10);
     v = settings.value ("appendEmptyLine");
     textTabSize_ = qBound (2, settings.value ("textTabSize", 8).toInt(), 10);
+    undoBudget_ = qBound (4, settings.value ("undoBudget", 256).toInt(), 4096);
+    totalUndoBudget_ = qBound (undoBudget_, settings.value ("totalUndoBudget", 1024).toInt(), 16384);
+    hibernateAfter_ = qBound (0, settings.value ("hibernateAfter", 30).toInt(), 10080);
+    hibernateMemory_ = qBound (0, settings.value ("hibernateMemory", 2048).toInt(), 1048576);
+    backgroundRelayout_ = settings.value ("backgroundRelayout", true).toBool();
     settings.endGroup();
 }
 void Config::resetFont()
@@ -158,6 +168,11 @@ void Config::writeConfig()
     settings.setValue ("saveUnmodified", saveUnmodified_);
     settings.setValue ("maxSHSize", maxSHSize_);
     settings.setValue ("textTabSize", textTabSize_);
+    settings.setValue ("undoBudget", undoBudget_);
+    settings.setValue ("totalUndoBudget", totalUndoBudget_);
+    settings.setValue ("hibernateAfter", hibernateAfter_);
+    settings.setValue ("hibernateMemory", hibernateMemory_);
+    settings.setValue ("backgroundRelayout", backgroundRelayout_);
     settings.endGroup();
     settings.beginGroup ("shortcuts");
 
@@ -175,6 +175,37 @@ public:
     void setLastFileCursorPos (const QHash<QString, QVariant>& curPos) {
         lasFilesCursorPos_ = curPos;
     }
+    /*
+     * The budgets of the undo histories in MiB, per tab and in total.
+     * The size is estimated as 2 bytes per removed or added character, and
+     * the largest edit of a tab isn't counted. A history over its budget
+     * is cleared as a whole, i.e. all undo steps of the tab are lost. Over
+     * the total budget, only the histories of hidden tabs are cleared.
+     */
+    int getUndoBudget() const {
+        return undoBudget_;
+    }
+    int getTotalUndoBudget() const {
+        return totalUndoBudget_;
+    }
+    /*
+     * Unmodified background tabs are hibernated after this many idle
+     * minutes (0 for never) or while the documents take more than this
+     * many MiB (0 for no limit).
+     */
+    int getHibernateAfter() const {
+        return hibernateAfter_;
+    }
+    int getHibernateMemory() const {
+        return hibernateMemory_;
+    }
+    /*
+     * Whether the hidden tabs get their changed settings (wrapping, font,
+     * tab size) in the background or only when they are shown.
+     */
+    bool getBackgroundRelayout() const {
+        return backgroundRelayout_;
+    }
     bool getSaveUnmodified() const {
         return saveUnmodified_;
     }
@@ -189,9 +220,12 @@ private:
 
     bool remSize_, remPos_,
          isMaxed_, isFull_,
-         saveUnmodified_;
+         saveUnmodified_,
+         backgroundRelayout_;
     int maxSHSize_,
-        textTabSize_;
+        textTabSize_,
+        undoBudget_, totalUndoBudget_,
+        hibernateAfter_, hibernateMemory_;
     QSize winSize_, startSize_, prefSize_;
     QPoint winPos_;
     QFont font_;
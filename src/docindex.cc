@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <sys/stat.h>
+#include "docindex.h"
+
+namespace fpad {
+
+typedef QPair<quint64, quint64> FileId; // device and inode
+
+struct IndexEntry {
+    FileId id;
+    bool hasId;
+    QString path;
+};
+
+struct IndexData {
+    QMultiHash<FileId, TextEdit*> byId;
+    QMultiHash<QString, TextEdit*> byPath;
+    QHash<TextEdit*, IndexEntry> entries;
+};
+
+static IndexData &indexData()
+{
+    static IndexData data;
+    return data;
+}
+
+/* Follows symlinks, like opening the file does. */
+static bool fileId (const QString &fileName, FileId *id)
+{
+    struct stat st;
+    if (::stat (QFile::encodeName (fileName).constData(), &st) != 0)
+        return false;
+    *id = qMakePair (static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino));
+    return true;
+}
+
+static QString canonicalPath (const QString &fileName)
+{
+    const QFileInfo info (fileName);
+    const QString path = info.canonicalFilePath();
+    return path.isEmpty() ? QDir::cleanPath (info.absoluteFilePath()) : path;
+}
+
+void DocIndex::insert (TextEdit *textEdit, const QString &fileName)
+{
+    remove (textEdit);
+    if (fileName.isEmpty()) return;
+    IndexData &data = indexData();
+    IndexEntry entry;
+    entry.hasId = fileId (fileName, &entry.id);
+    entry.path = canonicalPath (fileName);
+    if (entry.hasId)
+        data.byId.insert (entry.id, textEdit);
+    data.byPath.insert (entry.path, textEdit);
+    data.entries.insert (textEdit, entry);
+}
+
+void DocIndex::remove (TextEdit *textEdit)
+{
+    IndexData &data = indexData();
+    auto it = data.entries.find (textEdit);
+    if (it == data.entries.end()) return;
+    if (it->hasId)
+        data.byId.remove (it->id, textEdit);
+    data.byPath.remove (it->path, textEdit);
+    data.entries.erase (it);
+}
+
+QList<TextEdit*> DocIndex::find (const QString &fileName)
+{
+    IndexData &data = indexData();
+    QList<TextEdit*> res;
+    FileId id;
+    if (fileId (fileName, &id))
+    {
+        /* an inode may be reused after its file is deleted */
+        const QList<TextEdit*> hits = data.byId.values (id);
+        for (TextEdit *textEdit : hits)
+        {
+            const IndexEntry entry = data.entries.value (textEdit);
+            FileId current;
+            if (fileId (entry.path, &current) && current == id)
+                res << textEdit;
+            else // stale
+            {
+                data.byId.remove (entry.id, textEdit);
+                data.entries[textEdit].hasId = false;
+            }
+        }
+        if (!res.isEmpty())
+            return res;
+    }
+    /* the file doesn't exist or has been replaced since it was indexed */
+    return data.byPath.values (canonicalPath (fileName));
+}
+
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef DOCINDEX_H
+#define DOCINDEX_H
+
+#include <QString>
+#include <QList>
+
+namespace fpad {
+
+class TextEdit;
+
+/* A per-process index of the files of the open documents, by device and
+   inode, which hard links and symlinks to a file share, and by canonical
+   path, for files that don't exist or have been replaced. It is updated
+   whenever the file name of an editor is set and when an editor is
+   destroyed, so that finding the editors of a file needs a single stat()
+   instead of one per tab. */
+class DocIndex
+{
+public:
+    static void insert (TextEdit *textEdit, const QString &fileName);
+    static void remove (TextEdit *textEdit);
+    static QList<TextEdit*> find (const QString &fileName);
+};
+
+}
+
+#endif // DOCINDEX_H
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include <QDirIterator>
+#include <QFile>
+#include <QRunnable>
+#include <QTextCodec>
+#include <QThreadPool>
+#include <cstring>
+#include "filesearch.h"
+#include "encoding.h"
+
+#define MAX_FILE_SIZE 100*1024*1024 // the same limit as in Loading::run()
+#define MAX_MATCHES_PER_FILE 1000
+#define PROGRESS_INTERVAL 250
+
+namespace fpad {
+
+class WalkJob : public QRunnable
+{
+public:
+    WalkJob (const QSharedPointer<FileSearch>& search) : search_ (search) {}
+    void run() override {
+        search_->walk();
+        search_->jobDone();
+    }
+private:
+    QSharedPointer<FileSearch> search_;
+};
+
+class GrepJob : public QRunnable
+{
+public:
+    GrepJob (const QSharedPointer<FileSearch>& search, const QString& file) :
+        search_ (search), file_ (file) {}
+    void run() override {
+        search_->grep (file_);
+        search_->jobDone();
+    }
+private:
+    QSharedPointer<FileSearch> search_;
+    QString file_;
+};
+
+QSharedPointer<FileSearch> FileSearch::create (const QString& dir,
+                                               const QString& pattern,
+                                               bool caseSensitive, bool isRegex)
+{
+    /* the last job may release the search in a worker thread */
+    QSharedPointer<FileSearch> search (new FileSearch (dir, pattern, caseSensitive, isRegex),
+                                       &QObject::deleteLater);
+    search->self_ = search;
+    return search;
+}
+
+FileSearch::FileSearch (const QString& dir, const QString& pattern,
+                        bool caseSensitive, bool isRegex) :
+    QObject(),
+    dir_ (dir),
+    finder_ (pattern, caseSensitive, isRegex),
+    cancel_ (0),
+    pending_ (0),
+    files_ (0),
+    bytes_ (0)
+{
+    static const int registered = qRegisterMetaType<QVector<fpad::TextMatch> >();
+    Q_UNUSED (registered);
+    progressTimer_ = new QTimer (this);
+    progressTimer_->setInterval (PROGRESS_INTERVAL);
+    connect (progressTimer_, &QTimer::timeout, this, &FileSearch::reportProgress);
+    connect (this, &FileSearch::finished, progressTimer_, &QTimer::stop);
+}
+
+FileSearch::~FileSearch() {}
+
+void FileSearch::start()
+{
+    if (!isValid() || pending_.load() > 0) return;
+    timer_.start();
+    progressTimer_->start();
+    pending_.store (1);
+    QThreadPool::globalInstance()->start (new WalkJob (self_.toStrongRef()));
+}
+
+void FileSearch::cancel()
+{
+    cancel_.store (1);
+}
+
+void FileSearch::reportProgress()
+{
+    emit progress (searchedFiles(), searchedBytes(), elapsed());
+}
+
+void FileSearch::jobDone()
+{
+    if (!pending_.deref())
+    {
+        reportProgress();
+        emit finished();
+    }
+}
+
+/* Hidden files and folders are skipped and symlinked folders aren't
+   followed (to prevent infinite loops). To keep the queue short, files
+   are searched in the walker's thread when all workers are busy. */
+void FileSearch::walk()
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int maxPending = 4 * qMax (pool->maxThreadCount(), 1);
+    QDirIterator it (dir_, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    while (it.hasNext() && !isCanceled())
+    {
+        const QString file = it.next();
+        if (pending_.load() > maxPending)
+            grep (file);
+        else
+        {
+            pending_.ref();
+            pool->start (new GrepJob (self_.toStrongRef(), file));
+        }
+    }
+}
+
+void FileSearch::grep (const QString& file)
+{
+    if (isCanceled()) return;
+
+    QFile f (file);
+    const qint64 size = f.size();
+    if (size <= 0 || size > MAX_FILE_SIZE || !f.open (QFile::ReadOnly))
+        return;
+
+    QByteArray buffer;
+    const char *data = reinterpret_cast<const char*>(f.map (0, size));
+    if (data == nullptr)
+    { // mapping isn't supported by every file system
+        buffer = f.readAll();
+        data = buffer.constData();
+    }
+    files_.ref();
+    bytes_.fetchAndAddRelaxed (size);
+
+    /* like Loading::run(), consider a file with a null character as binary
+       (UTF-16/32 files are skipped too because they can't be decoded safely) */
+    if (std::memchr (data, '\0', static_cast<size_t>(size)) != nullptr)
+        return;
+
+    QTextCodec::ConverterState state;
+    QString text = QTextCodec::codecForName ("UTF-8")->toUnicode (data, static_cast<int>(size), &state);
+    if (state.invalidChars > 0)
+    {
+        const QByteArray bytes (data, static_cast<int>(size)); // detectCharset() needs a null
+        if (QTextCodec *codec = QTextCodec::codecForName (detectCharset (bytes).toUtf8()))
+            text = codec->toUnicode (bytes);
+    }
+    f.close(); // also unmaps the file
+
+    const QVector<TextMatch> matches = finder_.findAll (text, &cancel_, MAX_MATCHES_PER_FILE);
+    if (!matches.isEmpty() && !isCanceled())
+        emit found (file, matches);
+}
+
+}
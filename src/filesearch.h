@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "textfinder.h"
+
+namespace fpad {
+
+/* Searches the files of a directory recursively. The directory is walked
+   in a worker thread, which queues a job per file in the global thread pool.
+   Matches are sent file by file as soon as they are found.
+
+   The object is shared by the jobs and should be created with create(),
+   so that it is deleted (in its own thread) only after the last job. */
+class FileSearch : public QObject
+{
+    Q_OBJECT
+public:
+    static QSharedPointer<FileSearch> create (const QString& dir,
+                                              const QString& pattern,
+                                              bool caseSensitive, bool isRegex);
+    ~FileSearch();
+
+    bool isValid() const {
+        return finder_.isValid();
+    }
+    QString directory() const {
+        return dir_;
+    }
+    void start();
+    void cancel();
+    bool isCanceled() const {
+        return cancel_.load() != 0;
+    }
+
+    int searchedFiles() const {
+        return files_.load();
+    }
+    qint64 searchedBytes() const {
+        return bytes_.load();
+    }
+    qint64 elapsed() const {
+        return timer_.elapsed();
+    }
+
+signals:
+    void found (const QString& file, const QVector<fpad::TextMatch>& matches);
+    void progress (int files, qint64 bytes, qint64 msecs);
+    void finished();
+
+private:
+    FileSearch (const QString& dir, const QString& pattern,
+                bool caseSensitive, bool isRegex);
+
+    void walk();
+    void grep (const QString& file);
+    void jobDone();
+    void reportProgress();
+
+    QString dir_;
+    TextFinder finder_;
+    QAtomicInt cancel_;
+    QAtomicInt pending_; // the walker and the file jobs that aren't done yet
+    QAtomicInt files_;
+    QAtomicInteger<qint64> bytes_;
+    QElapsedTimer timer_;
+    QTimer *progressTimer_;
+    QWeakPointer<FileSearch> self_;
+
+    friend class WalkJob;
+    friend class GrepJob;
+};
+
+}
+
+#endif // FILESEARCH_H
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QDir>
+#include "filesearchdock.h"
+#include "filedialog.h"
+
+namespace fpad {
+
+FileSearchDock::FileSearchDock (QWidget *parent)
+    : ResultsDock ("Found in Files", parent),
+      running_ (false)
+{
+    dirEdit_ = new QLineEdit (contents());
+    dirEdit_->setPlaceholderText ("Folder");
+    dirEdit_->setClearButtonEnabled (true);
+    dirButton_ = new QToolButton (contents());
+    dirButton_->setText ("...");
+    dirButton_->setToolTip ("Choose a folder");
+    patternEdit_ = new QLineEdit (contents());
+    patternEdit_->setPlaceholderText ("Search...");
+    patternEdit_->setClearButtonEnabled (true);
+    caseBox_ = new QCheckBox ("Match case", contents());
+    regexBox_ = new QCheckBox ("Regex", contents());
+    button_ = new QPushButton ("Search", contents());
+
+    QHBoxLayout *row = new QHBoxLayout;
+    row->setContentsMargins (0, 0, 0, 0);
+    row->setSpacing (2);
+    row->addWidget (dirEdit_, 1);
+    row->addWidget (dirButton_);
+    row->addWidget (patternEdit_, 2);
+    row->addWidget (caseBox_);
+    row->addWidget (regexBox_);
+    row->addWidget (button_);
+    if (QVBoxLayout *layout = qobject_cast<QVBoxLayout*>(contents()->layout()))
+        layout->insertLayout (0, row);
+
+    connect (dirButton_, &QAbstractButton::clicked, this, &FileSearchDock::chooseDirectory);
+    connect (button_, &QAbstractButton::clicked, this, &FileSearchDock::onButtonClicked);
+    connect (patternEdit_, &QLineEdit::returnPressed, this, [this] {
+        if (!running_) onButtonClicked();
+    });
+    connect (dirEdit_, &QLineEdit::returnPressed, this, [this] {
+        if (!running_) onButtonClicked();
+    });
+}
+
+void FileSearchDock::setDirectory (const QString& dir)
+{
+    dirEdit_->setText (dir);
+}
+
+void FileSearchDock::setPattern (const QString& pattern)
+{
+    patternEdit_->setText (pattern);
+}
+
+void FileSearchDock::focusPattern()
+{
+    patternEdit_->setFocus();
+    patternEdit_->selectAll();
+}
+
+void FileSearchDock::setRunning (bool running)
+{
+    running_ = running;
+    button_->setText (running ? "Stop" : "Search");
+}
+
+void FileSearchDock::chooseDirectory()
+{
+    FileDialog dialog (this);
+    dialog.setAcceptMode (QFileDialog::AcceptOpen);
+    dialog.setWindowTitle ("Choose a folder...");
+    dialog.setFileMode (QFileDialog::Directory);
+    dialog.setOption (QFileDialog::ShowDirsOnly, true);
+    dialog.setDirectory (QDir (dirEdit_->text()).exists() ? dirEdit_->text() : QDir::homePath());
+    if (dialog.exec())
+    {
+        const QStringList dirs = dialog.selectedFiles();
+        if (!dirs.isEmpty())
+            dirEdit_->setText (dirs.at (0));
+    }
+}
+
+void FileSearchDock::onButtonClicked()
+{
+    if (running_)
+    {
+        emit stopRequested();
+        return;
+    }
+    const QString pattern = patternEdit_->text();
+    if (pattern.isEmpty())
+    {
+        focusPattern();
+        return;
+    }
+    QString dir = dirEdit_->text().trimmed();
+    if (dir.startsWith ("~"))
+        dir.replace (0, 1, QDir::homePath());
+    if (!QDir (dir).exists())
+    {
+        setStatus ("No such folder");
+        dirEdit_->setFocus();
+        return;
+    }
+    emit searchRequested (QDir (dir).absolutePath(), pattern,
+                          caseBox_->isChecked(), regexBox_->isChecked());
+}
+
+}
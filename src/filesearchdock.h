@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef FILESEARCHDOCK_H
+#define FILESEARCHDOCK_H
+
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QToolButton>
+#include "resultsdock.h"
+
+namespace fpad {
+
+/* The results dock of "Find in Files", with the search inputs above the list. */
+class FileSearchDock : public ResultsDock
+{
+    Q_OBJECT
+public:
+    FileSearchDock (QWidget *parent = nullptr);
+
+    void setDirectory (const QString& dir);
+    void setPattern (const QString& pattern);
+    void focusPattern();
+    void setRunning (bool running);
+
+signals:
+    void searchRequested (const QString& dir, const QString& pattern,
+                          bool caseSensitive, bool isRegex);
+    void stopRequested();
+
+private:
+    void chooseDirectory();
+    void onButtonClicked();
+
+    QPointer<QLineEdit> dirEdit_;
+    QPointer<QToolButton> dirButton_;
+    QPointer<QLineEdit> patternEdit_;
+    QPointer<QCheckBox> caseBox_;
+    QPointer<QCheckBox> regexBox_;
+    QPointer<QPushButton> button_;
+    bool running_;
+};
+
+}
+
+#endif // FILESEARCHDOCK_H
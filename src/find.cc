@@ -17,9 +17,15 @@
  * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
  */
 
-#include "fpwin.h"
+#include "singleton.h"
 #include "ui_fp.h"
-#include <QTextDocumentFragment>
+#include "searchjob.h"
+#include <QTextBlock>
+#include <QThreadPool>
+#include <QDir>
+#include <QRegularExpression>
+
+#define VISIBLE_REGEX_MARGIN 100 // a regex match may be partially visible
 
 namespace fpad {
 void FPwin::find (bool forward)
@@ -29,6 +35,8 @@ void FPwin::find (bool forward)
     TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
     if (tabPage == nullptr) return;
 
+    cancelIncrementalSearch();
+
     TextEdit *textEdit = tabPage->textEdit();
     QString txt = tabPage->searchEntry();
     bool newSrch = false;
@@ -37,6 +45,7 @@ void FPwin::find (bool forward)
         textEdit->setSearchedText (txt);
         newSrch = true;
     }
+    textEdit->setOverviewSearch (txt, tabPage->matchCase(), tabPage->matchRegex());
 
     disconnect (textEdit, &TextEdit::resized, this, &FPwin::hlight);
     disconnect (textEdit, &TextEdit::updateRect, this, &FPwin::hlight);
@@ -83,8 +92,336 @@ void FPwin::find (bool forward)
     connect (textEdit, &TextEdit::updateRect, this, &FPwin::hlight);
     connect (textEdit, &TextEdit::resized, this, &FPwin::hlight);
 }
+/*
+ * Any running incremental search is stale after this.
+ */
+void FPwin::cancelIncrementalSearch()
+{
+    if (incrementalCancel_)
+        incrementalCancel_->store (1);
+    ++incrementalId_;
+}
+/*
+ * Searches a snapshot of the document in the thread pool for the
+ * first match at or after the cursor, so that typing isn't blocked.
+ */
+void FPwin::incrementalSearch()
+{
+    if (!isReady()) return;
+
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+
+    cancelIncrementalSearch();
+    const QString txt = tabPage->searchEntry();
+    if (txt.isEmpty())
+    {
+        find (true); // remove the highlights
+        return;
+    }
+    const bool cs = tabPage->matchCase();
+    const bool regex = tabPage->matchRegex();
+    if (!TextFinder (txt, cs, regex).isValid())
+        return; // the regex may be incomplete
+
+    TextEdit *textEdit = tabPage->textEdit();
+    incrementalCancel_ = QSharedPointer<QAtomicInt> (new QAtomicInt (0));
+    incrementalTab_ = tabPage;
+    incrementalText_ = txt;
+    incrementalRevision_ = textEdit->document()->revision();
+    /* start from the current match (if any) to extend it while typing */
+    FirstMatchJob *job = new FirstMatchJob (incrementalId_, textEdit->plainTextSnapshot(),
+                                            textEdit->textCursor().selectionStart(),
+                                            txt, cs, regex, incrementalCancel_);
+    connect (job, &FirstMatchJob::found, this, &FPwin::onIncrementalMatch);
+    QThreadPool::globalInstance()->start (job);
+}
+void FPwin::onIncrementalMatch (int id, int position, int length)
+{
+    if (id != incrementalId_) return; // stale
+
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr || tabPage != incrementalTab_
+        || tabPage->searchEntry() != incrementalText_)
+    {
+        return;
+    }
+    TextEdit *textEdit = tabPage->textEdit();
+    if (textEdit->document()->revision() != incrementalRevision_)
+        return; // the snapshot is outdated
+
+    textEdit->setSearchedText (incrementalText_);
+    textEdit->setOverviewSearch (incrementalText_, tabPage->matchCase(), tabPage->matchRegex());
+    if (position > -1)
+    {
+        QTextCursor start = textEdit->textCursor();
+        start.setPosition (position);
+        start.setPosition (position + length, QTextCursor::KeepAnchor);
+        textEdit->setTextCursor (start);
+        textEdit->centerCursor();
+    }
+    hlight();
+    connect (textEdit, &QPlainTextEdit::textChanged, this, &FPwin::hlight, Qt::UniqueConnection);
+    connect (textEdit, &TextEdit::updateRect, this, &FPwin::hlight, Qt::UniqueConnection);
+    connect (textEdit, &TextEdit::resized, this, &FPwin::hlight, Qt::UniqueConnection);
+}
+/*
+ * Searches snapshots of all tabs in the thread pool and
+ * streams the results into a dock.
+ */
+void FPwin::findInAllTabs()
+{
+    if (!isReady()) return;
+
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+
+    const QString txt = tabPage->searchEntry();
+    if (txt.isEmpty())
+    {
+        showHideSearch();
+        return;
+    }
+
+    /* stop the previous search, if any */
+    if (tabSearchCancel_)
+        tabSearchCancel_->store (1);
+    tabSearchCancel_ = QSharedPointer<QAtomicInt> (new QAtomicInt (0));
+    searchedTabs_.clear();
+    pendingTabSearches_ = 0;
+
+    if (tabResultsDock_ == nullptr)
+    {
+        tabResultsDock_ = new ResultsDock ("Found in Tabs", this);
+        addDockWidget (Qt::BottomDockWidgetArea, tabResultsDock_);
+        connect (tabResultsDock_, &ResultsDock::resultActivated, this, &FPwin::jumpToTabResult);
+    }
+    tabResultsDock_->clearResults();
+    tabResultsDock_->setVisible (true);
+    tabResultsDock_->raise();
+
+    const bool cs = tabPage->matchCase();
+    const bool regex = tabPage->matchRegex();
+    if (!TextFinder (txt, cs, regex).isValid())
+    {
+        tabResultsDock_->setStatus ("Invalid regular expression");
+        return;
+    }
+
+    int count = ui->tabWidget->count();
+    for (int i = 0; i < count; ++i)
+    {
+        TabPage *page = qobject_cast< TabPage *>(ui->tabWidget->widget (i));
+        if (page == nullptr) continue;
+        int id = ++tabSearchId_;
+        searchedTabs_.insert (id, page);
+        TextEdit *textEdit = page->textEdit();
+        SearchJob *job;
+        if (textEdit->isHibernated())
+        { // its document is empty, so its file is searched
+            job = new SearchJob (id, QString(), txt, cs, regex, tabSearchCancel_);
+            job->setFile (textEdit->getFileName(), textEdit->getEncoding());
+        }
+        else
+        { // only the snapshot of the current tab is cached for later searches
+            job = new SearchJob (id, page == tabPage ? textEdit->plainTextSnapshot()
+                                                     : textEdit->takePlainTextSnapshot(),
+                                 txt, cs, regex, tabSearchCancel_);
+        }
+        connect (job, &SearchJob::found, this, &FPwin::onTabMatches);
+        connect (job, &SearchJob::done, this, &FPwin::onTabSearchDone);
+        ++pendingTabSearches_;
+        QThreadPool::globalInstance()->start (job);
+    }
+    tabResultsDock_->setStatus ("Searching...");
+}
+void FPwin::onTabMatches (int id, const QVector<TextMatch>& matches)
+{
+    if (tabResultsDock_ == nullptr) return;
+    TabPage *page = searchedTabs_.value (id); // null if the results are stale
+    if (page == nullptr) return;
+    int index = ui->tabWidget->indexOf (page);
+    if (index < 0) return;
+    const QString name = ui->tabWidget->tabText (index);
+    for (const auto &m : matches)
+    {
+        if (!page->textEdit()->isHibernated())
+            page->textEdit()->prefetchLayout (m.line); // the results are jump targets
+        if (!tabResultsDock_->addResult (QString ("%1:%2:%3: %4").arg (name,
+                                                                      QString::number (m.line + 1),
+                                                                      QString::number (m.column + 1),
+                                                                      m.context.simplified()),
+                                         id, m.line, m.column))
+        {
+            tabSearchCancel_->store (1); // the dock is full
+            break;
+        }
+    }
+}
+void FPwin::onTabSearchDone (int id)
+{
+    if (tabResultsDock_ == nullptr || !searchedTabs_.contains (id)) return;
+    if (--pendingTabSearches_ > 0) return;
+    int n = tabResultsDock_->resultCount();
+    if (n == 0)
+        tabResultsDock_->setStatus ("No match");
+    else if (tabSearchCancel_->load() != 0)
+        tabResultsDock_->setStatus (QString ("%1 matches (truncated)").arg (n));
+    else
+        tabResultsDock_->setStatus (n == 1 ? QString ("One match")
+                                           : QString ("%1 matches").arg (n));
+}
+void FPwin::jumpToTabResult (const QVariant& key, int line, int column)
+{
+    TabPage *page = searchedTabs_.value (key.toInt());
+    if (page == nullptr) return;
+    int index = ui->tabWidget->indexOf (page);
+    if (index < 0) return;
+    /* FPsingleton::switchToExistingTab() expects the command-line line number + 1 */
+    static_cast<FPsingleton*>(qApp)->switchToExistingTab (this, index, line + 2, column, true);
+    page->textEdit()->setFocus();
+}
+static QString fileSearchStatus (int matches, int files, qint64 bytes, qint64 msecs)
+{
+    const double secs = static_cast<double>(qMax (msecs, static_cast<qint64>(1))) / 1000;
+    return QString ("%1 matches in %2 files (%3 files/s, %4 MB/s)")
+           .arg (matches)
+           .arg (files)
+           .arg (qRound (files / secs))
+           .arg (static_cast<double>(bytes) / (1000 * 1000) / secs, 0, 'f', 1);
+}
+/*
+ * Shows the "Find in Files" dock. The search itself
+ * is started from the dock.
+ */
+void FPwin::findInFiles()
+{
+    if (fileResultsDock_ == nullptr)
+    {
+        fileResultsDock_ = new FileSearchDock (this);
+        addDockWidget (Qt::BottomDockWidgetArea, fileResultsDock_);
+        connect (fileResultsDock_, &FileSearchDock::searchRequested, this, &FPwin::startFileSearch);
+        connect (fileResultsDock_, &FileSearchDock::stopRequested, this, &FPwin::stopFileSearch);
+        connect (fileResultsDock_, &ResultsDock::resultActivated, this, &FPwin::openFileResult);
+
+        QString dir;
+        if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget()))
+        {
+            const QString fname = tabPage->textEdit()->getFileName();
+            if (!fname.isEmpty())
+                dir = QFileInfo (fname).absolutePath();
+        }
+        fileResultsDock_->setDirectory (dir.isEmpty() ? QDir::currentPath() : dir);
+    }
+
+    if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget()))
+    {
+        QString txt = tabPage->textEdit()->textCursor().selectedText();
+        if (txt.isEmpty() || txt.contains (QChar (QChar::ParagraphSeparator)))
+            txt = tabPage->searchEntry();
+        if (!txt.isEmpty())
+            fileResultsDock_->setPattern (txt);
+    }
+    fileResultsDock_->setVisible (true);
+    fileResultsDock_->raise();
+    fileResultsDock_->focusPattern();
+}
+void FPwin::startFileSearch (const QString& dir, const QString& pattern,
+                             bool caseSensitive, bool isRegex)
+{
+    if (fileResultsDock_ == nullptr) return;
+    if (fileSearch_)
+    { // results of the previous search aren't wanted anymore
+        disconnect (fileSearch_.data(), nullptr, this, nullptr);
+        fileSearch_->cancel();
+    }
+    fileResultsDock_->clearResults();
+
+    fileSearch_ = FileSearch::create (dir, pattern, caseSensitive, isRegex);
+    if (!fileSearch_->isValid())
+    {
+        fileSearch_.clear();
+        fileResultsDock_->setRunning (false);
+        fileResultsDock_->setStatus ("Invalid regular expression");
+        return;
+    }
+    connect (fileSearch_.data(), &FileSearch::found, this, &FPwin::onFileMatches);
+    connect (fileSearch_.data(), &FileSearch::progress, this, &FPwin::onFileSearchProgress);
+    connect (fileSearch_.data(), &FileSearch::finished, this, &FPwin::onFileSearchFinished);
+    fileResultsDock_->setRunning (true);
+    fileResultsDock_->setStatus ("Searching...");
+    fileSearch_->start();
+}
+void FPwin::stopFileSearch()
+{
+    if (fileSearch_)
+        fileSearch_->cancel(); // the dock is updated when the search is finished
+}
+void FPwin::onFileMatches (const QString& file, const QVector<TextMatch>& matches)
+{
+    /* already queued signals of an old search may arrive after disconnection */
+    if (fileResultsDock_ == nullptr || sender() != fileSearch_.data()) return;
+    const QString name = QDir (fileSearch_->directory()).relativeFilePath (file);
+    for (const auto &m : matches)
+    {
+        if (!fileResultsDock_->addResult (QString ("%1:%2:%3: %4").arg (name,
+                                                                       QString::number (m.line + 1),
+                                                                       QString::number (m.column + 1),
+                                                                       m.context.simplified()),
+                                          file, m.line, m.column))
+        {
+            fileSearch_->cancel(); // the dock is full
+            break;
+        }
+    }
+}
+void FPwin::onFileSearchProgress (int files, qint64 bytes, qint64 msecs)
+{
+    if (fileResultsDock_ == nullptr || sender() != fileSearch_.data()) return;
+    fileResultsDock_->setStatus ("Searching... "
+                                 + fileSearchStatus (fileResultsDock_->resultCount(),
+                                                     files, bytes, msecs));
+}
+void FPwin::onFileSearchFinished()
+{
+    if (fileResultsDock_ == nullptr || sender() != fileSearch_.data()) return;
+    fileResultsDock_->setRunning (false);
+    QString status = fileSearchStatus (fileResultsDock_->resultCount(),
+                                       fileSearch_->searchedFiles(),
+                                       fileSearch_->searchedBytes(),
+                                       fileSearch_->elapsed());
+    if (fileSearch_->isCanceled())
+        status = "Stopped: " + status;
+    fileResultsDock_->setStatus (status);
+}
+/*
+ * Opens a result like "fpad file:L,P" does from the command line.
+ */
+void FPwin::openFileResult (const QVariant& key, int line, int column)
+{
+    const QString file = key.toString();
+    if (!QFile::exists (file))
+    {
+        if (fileResultsDock_)
+            fileResultsDock_->setStatus ("The file does not exist anymore");
+        return;
+    }
+    FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
+    bool modified = false;
+    int idx = already_opened_idx (file, modified);
+    if (idx != -2 && !modified)
+        singleton->switchToExistingTab (singleton->Wins.at (0), idx, line + 2, column, true);
+    else
+        newTabFromName (file, line + 2, column);
+}
+/*
+ * Highlights the matches in the visible part of the document. Only the
+ * visible text lines (clipped to the visible columns without wrapping)
+ * are searched, so that huge lines or documents don't slow it down.
+ */
 void FPwin::hlight() const
 {
+    TRACE_SCOPE ("FPwin::hlight");
     TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
     if (tabPage == nullptr) return;
     TextEdit *textEdit = tabPage->textEdit();
@@ -92,39 +429,80 @@ void FPwin::hlight() const
     if (txt.isEmpty()) return;
     QTextDocument::FindFlags searchFlags = getSearchFlags();
     QList<QTextEdit::ExtraSelection> es = textEdit->getGreenSel();
-    
-    QTextCursor found;
-    QPoint Point (0, 0);
-    QTextCursor start = textEdit->cursorForPosition (Point);
-    int startPos = start.position() - (!tabPage->matchRegex() ? txt.length() : 0);
-    if (startPos >= 0)
-        start.setPosition (startPos);
-    else
-        start.setPosition (0);
-    Point = QPoint (textEdit->geometry().width(), textEdit->geometry().height());
-    QTextCursor end = textEdit->cursorForPosition (Point);
-    int endLimit = end.anchor();
-    int endPos = end.position() + (!tabPage->matchRegex() ? txt.length() : 0);
-    end.movePosition (QTextCursor::End);
-    if (endPos <= end.position())
-        end.setPosition (endPos);
-    QTextCursor visCur = start;
-    visCur.setPosition (end.position(), QTextCursor::KeepAnchor);
-    const QString str = visCur.selection().toPlainText();
+    const bool regex = tabPage->matchRegex();
     Qt::CaseSensitivity cs = tabPage->matchCase() ? Qt::CaseSensitive : Qt::CaseInsensitive;
-    
+
     QColor bg = QColor( 255, 233, 125 );
-    QColor fg = QColor( 0, 0, 0 );    
-    if (tabPage->matchRegex() || str.contains (txt, cs))
+    QColor fg = QColor( 0, 0, 0 );
+    QTextCursor found (textEdit->document());
+    auto addMatch = [&es, &found, &bg, &fg] (int pos, int len) {
+        found.setPosition (pos);
+        found.setPosition (pos + len, QTextCursor::KeepAnchor);
+        QTextEdit::ExtraSelection extra;
+        extra.format.setBackground ( bg );
+        extra.format.setForeground ( fg );
+        extra.cursor = found;
+        es.append (extra);
+    };
+
+    /* a literal match may be partially visible */
+    const QList<QPair<int, int> > ranges = textEdit->visibleRanges (regex ? VISIBLE_REGEX_MARGIN
+                                                                          : txt.length() - 1);
+    if (!ranges.isEmpty())
     {
-        while (!(found = textEdit->finding (txt, start, searchFlags,  tabPage->matchRegex(), endLimit)).isNull())
+        if (!regex && txt.contains ('\n'))
+        { // a multi-line string may start before the first visible line
+            QTextCursor start (textEdit->document());
+            start.setPosition (qMax (ranges.first().first - txt.length(), 0));
+            const int endLimit = ranges.last().second;
+            while (!(found = textEdit->finding (txt, start, searchFlags, false, endLimit)).isNull())
+            {
+                addMatch (found.anchor(), found.position() - found.anchor());
+                start.setPosition (found.position());
+            }
+        }
+        else if (regex)
+        {
+            QRegularExpression regexp (txt, tabPage->matchCase() ? QRegularExpression::NoPatternOption
+                                                                 : QRegularExpression::CaseInsensitiveOption);
+            if (regexp.isValid())
+            {
+                for (const auto &range : ranges)
+                {
+                    /* with a character before and after the range (if any), anchors
+                       and look-arounds aren't fooled by the horizontal clipping */
+                    QTextBlock block = textEdit->document()->findBlock (range.first);
+                    const int a = qMax (range.first - 1, block.position());
+                    const int b = qMin (range.second + 1, block.position() + block.length() - 1);
+                    found.setPosition (a);
+                    found.setPosition (b, QTextCursor::KeepAnchor);
+                    const QString str = found.selectedText();
+                    QRegularExpressionMatchIterator it = regexp.globalMatch (str, range.first - a);
+                    while (it.hasNext())
+                    {
+                        QRegularExpressionMatch match = it.next();
+                        if (match.capturedStart() >= range.second - a) break;
+                        if (match.capturedLength() == 0) continue;
+                        addMatch (a + match.capturedStart(), match.capturedLength());
+                    }
+                }
+            }
+        }
+        else
         {
-            QTextEdit::ExtraSelection extra;
-            extra.format.setBackground ( bg );
-            extra.format.setForeground ( fg );
-            extra.cursor = found;
-            es.append (extra);
-            start.setPosition (found.position());
+            for (const auto &range : ranges)
+            {
+                found.setPosition (range.first);
+                found.setPosition (range.second, QTextCursor::KeepAnchor);
+                QString str = found.selectedText(); // only the visible part of a line
+                str.replace (QChar::Nbsp, QLatin1Char (' ')); // as in QTextDocument::find()
+                int indx = 0;
+                while ((indx = str.indexOf (txt, indx, cs)) > -1)
+                {
+                    addMatch (range.first + indx, txt.length());
+                    indx += txt.length();
+                }
+            }
         }
     }
     if (ui->spinBox->isVisible())
@@ -28,7 +28,19 @@ SOURCES += main.cc \
            loading.cc \
            tabpage.cc \
            searchbar.cc \
-           fontDialog.cc
+           fontDialog.cc \
+           textfinder.cc \
+           searchjob.cc \
+           resultsdock.cc \
+           filesearch.cc \
+           filesearchdock.cc \
+           tracer.cc \
+           multicursor.cc \
+           lazymimedata.cc \
+           undobudget.cc \
+           indentation.cc \
+           lineops.cc \
+           docindex.cc
 
 HEADERS += singleton.h \
            fpwin.h \
@@ -46,7 +58,18 @@ HEADERS += singleton.h \
            tabpage.h \
            searchbar.h \
            fontDialog.h \
-           warningbar.h
+           warningbar.h \
+           textfinder.h \
+           searchjob.h \
+           resultsdock.h \
+           filesearch.h \
+           filesearchdock.h \
+           blockdata.h \
+           tracer.h \
+           lazymimedata.h \
+           indentation.h \
+           lineops.h \
+           docindex.h
 
 FORMS += fp.ui \
          prefDialog.ui \
@@ -26,6 +26,7 @@
 #include "fontDialog.h"
 #include "loading.h"
 #include "warningbar.h"
+#include "docindex.h"
 #include <theme.h>
 
 #include <QWindow>
@@ -36,6 +37,9 @@
 #include <QTextBlock>
 #include <QFileInfo>
 #include <QPushButton>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <algorithm>
 
 namespace fpad {
 QString modified_prefix = QString("[*]");
@@ -56,10 +60,38 @@ FPwin::FPwin (QWidget *parent, bool standalone):QMainWindow (parent), dummyWidge
     
     /*
      * Dark theme stuff.
+     *
+     * The universal rule of the tab widget cascades to the editors, and an
+     * inherited style sheet beats their palette (-> TextEdit::TextEdit()),
+     * so their colors and scrollbars are styled here too (parsed once per
+     * window instead of per tab). The sheet of the nearest ancestor wins
+     * over those of centralWidget and the application.
      */
     ui->tabWidget->setStyleSheet(
-    	"background-color: " STR(WIDGETS_BG) ";"
-    	"color: " STR(WIDGETS_FG) ";"
+    	"* {"
+    	"	background-color: " STR(WIDGETS_BG) ";"
+    	"	color: " STR(WIDGETS_FG) ";}"
+    	"fpad--TextEdit {"
+    	"	background-color: " STR(TEXT_BG) ";"
+    	"	color: " STR(TEXT_FG) ";"
+    	"	selection-background-color: " STR(TEXT_SELECT_BG) ";"
+    	"	selection-color: " STR(TEXT_SELECT_FG) ";}"
+    	"fpad--TextEdit > .QWidget {" /* the viewport */
+    	"	background-color: " STR(TEXT_BG) ";"
+    	"	color: " STR(TEXT_FG) ";}"
+    	"fpad--TextEdit QScrollBar {"
+    	"	background: " STR(SCROLL_FG) ";}"
+    	"fpad--TextEdit QScrollBar::add-line {"
+    	"	border-color: " STR(SCROLL_FG) ";}"
+    	"fpad--TextEdit QScrollBar::sub-line {"
+    	"	border-color: " STR(SCROLL_FG) ";}"
+    	"fpad--TextEdit QScrollBar::add-page {"
+    	"	background: " STR(SCROLL_BG) ";}"
+    	"fpad--TextEdit QScrollBar::sub-page {"
+    	"	background: " STR(SCROLL_BG) ";}"
+    	"fpad--TextEdit QScrollBar::handle {"
+    	"	min-height: 75px;"
+    	"	border:1px solid " STR(SCROLL_FG) ";}"
     );
     ui->menuBar->setStyleSheet(
     	"background-color: " STR(WIDGETS_BG) ";"
@@ -87,6 +119,14 @@ FPwin::FPwin (QWidget *parent, bool standalone):QMainWindow (parent), dummyWidge
     rightClicked_ = -1;
     busyThread_ = nullptr;
     inactiveTabModified_ = false;
+    settingsScheduled_ = false;
+    QTimer *hibernationTimer = new QTimer (this);
+    connect (hibernationTimer, &QTimer::timeout, this, &FPwin::checkHibernation);
+    hibernationTimer->start (60000);
+    incrementalId_ = 0;
+    incrementalRevision_ = 0;
+    tabSearchId_ = 0;
+    pendingTabSearches_ = 0;
     ui->spinBox->hide();
     ui->label->hide();
     ui->checkBox->hide();
@@ -173,6 +213,19 @@ FPwin::FPwin (QWidget *parent, bool standalone):QMainWindow (parent), dummyWidge
     connect (ui->actionFont, &QAction::triggered, this, &FPwin::fontDialog);
     QShortcut* find_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_F), this);
     connect (find_shortcut , &QShortcut::activated, this, &FPwin::showHideSearch);
+    QShortcut* find_all_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_F), this);
+    connect (find_all_shortcut , &QShortcut::activated, this, &FPwin::findInAllTabs);
+    QShortcut* find_files_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::ALT + Qt::Key_F), this);
+    connect (find_files_shortcut , &QShortcut::activated, this, &FPwin::findInFiles);
+    /* hidden developer shortcuts */
+    QShortcut* trace_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::ALT + Qt::SHIFT + Qt::Key_T), this);
+    connect (trace_shortcut , &QShortcut::activated, this, &FPwin::toggleTracing);
+    QShortcut* dump_trace_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::ALT + Qt::SHIFT + Qt::Key_D), this);
+    connect (dump_trace_shortcut , &QShortcut::activated, this, &FPwin::dumpTrace);
+    QShortcut* bench_tabs_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::ALT + Qt::SHIFT + Qt::Key_B), this);
+    connect (bench_tabs_shortcut , &QShortcut::activated, this, &FPwin::benchmarkTabs);
+    if (Tracer::isEnabled()) // by FPAD_TRACE
+        traceOverlay_ = new TraceOverlay (this);
     QShortcut* jump_shortcut = new QShortcut(QKeySequence(Qt::ALT + Qt::Key_1), this);
     connect (jump_shortcut , &QShortcut::activated, this, &FPwin::jumpTo);
     connect (ui->spinBox, &QAbstractSpinBox::editingFinished, this, &FPwin::goTo);
@@ -208,6 +261,15 @@ FPwin::FPwin (QWidget *parent, bool standalone):QMainWindow (parent), dummyWidge
 }
 FPwin::~FPwin()
 {
+    if (incrementalCancel_)
+        incrementalCancel_->store (1);
+    if (tabSearchCancel_)
+        tabSearchCancel_->store (1);
+    if (fileSearch_)
+    {
+        disconnect (fileSearch_.data(), nullptr, this, nullptr);
+        fileSearch_->cancel();
+    }
     delete dummyWidget; dummyWidget = nullptr;
     delete aGroup_; aGroup_ = nullptr;
     delete ui; ui = nullptr;
@@ -265,6 +327,8 @@ void FPwin::applyConfigOnStarting()
     ui->actionWrap->setChecked( false );
     ui->tabWidget->setTabPosition(QTabWidget::North);
     ui->actionSave->setEnabled (config.getSaveUnmodified());
+    TextEdit::setUndoBudgets (static_cast<qint64>(config.getUndoBudget()) << 20,
+                              static_cast<qint64>(config.getTotalUndoBudget()) << 20);
 
     if (!config.hasReservedShortcuts())
     {
@@ -333,9 +397,9 @@ void FPwin::deleteTabPage (int tabIndex, bool saveToList)
     if (!fileName.isEmpty())
     {
         if (textEdit->getSaveCursor())
-            config.saveCursorPos (fileName, textEdit->textCursor().position());
+            config.saveCursorPos (fileName, textEdit->cursorPosition());
         if (saveToList && QFile::exists (fileName))
-            lastWinFilesCur_.insert (fileName, textEdit->textCursor().position());
+            lastWinFilesCur_.insert (fileName, textEdit->cursorPosition());
     }
     ui->tabWidget->removeTab (tabIndex);
     delete tabPage; tabPage = nullptr;
@@ -571,6 +635,7 @@ void FPwin::newTab()
 }
 TabPage* FPwin::createEmptyTab (bool setCurrent)
 {
+    TRACE_SCOPE ("FPwin::createEmptyTab");
     FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
     Config config = singleton->getConfig();
 
@@ -596,6 +661,18 @@ TabPage* FPwin::createEmptyTab (bool setCurrent)
     connect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
     connect (tabPage, &TabPage::find, this, &FPwin::find);
     connect (tabPage, &TabPage::searchFlagChanged, this, &FPwin::searchFlagChanged);
+    connect (tabPage, &TabPage::searchTextEdited, this, &FPwin::cancelIncrementalSearch);
+    connect (tabPage, &TabPage::incrementalSearch, this, &FPwin::incrementalSearch);
+    connect (textEdit, &TextEdit::undoMemoryChanged, this, [this, tabPage] {
+        updateTabTip (tabPage);
+    });
+    connect (textEdit, &TextEdit::undoHistoryCleared, this, [this, tabPage] {
+        int index = ui->tabWidget->indexOf (tabPage);
+        if (index < 0) return;
+        showWarningBar (QString ("<center>The undo history of \"%1\" was cleared.</center>\n"
+                                 "<center>It exceeded its memory budget.</center>")
+                        .arg (ui->tabWidget->tabText (index).toHtmlEscaped()));
+    });
     if (setCurrent)
     {
         ui->tabWidget->setCurrentWidget (tabPage);
@@ -661,6 +738,27 @@ void FPwin::editorContextMenu (const QPoint& p)
         }
         menu->addSeparator();
     }
+    if (!textEdit->isReadOnly())
+    { // on the selected lines or on all of them
+        QMenu *lines = menu->addMenu ("Lines");
+        const QList<QPair<QString, LineOperation> > lineOps = {
+            {"Sort", SortLines},
+            {"Sort Case-Insensitively", SortLinesCaseInsensitively},
+            {"Sort Numerically", SortLinesNumerically},
+            {"Sort Naturally", SortLinesNaturally},
+            {"Remove Duplicates", RemoveDuplicateLines},
+            {"Reverse", ReverseLines},
+            {"Shuffle", ShuffleLines},
+            {"Trim Trailing Whitespace", TrimTrailingSpaces}
+        };
+        for (const auto &lineOp : lineOps)
+        {
+            const LineOperation op = lineOp.second;
+            connect (lines->addAction (lineOp.first), &QAction::triggered, textEdit, [textEdit, op] {
+                textEdit->applyLineOperation (op);
+            });
+        }
+    }
     menu->exec (textEdit->viewport()->mapToGlobal (p));
     delete menu;
 }
@@ -693,6 +791,18 @@ void FPwin::focus_view_hard()
 {
     if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget()))
     {
+        /* Esc first ends a paste in progress or the multi-cursor mode */
+        TextEdit *textEdit = tabPage->textEdit();
+        if (textEdit->isPasting())
+        {
+            textEdit->cancelPaste();
+            return;
+        }
+        if (textEdit->hasMultiCursors())
+        {
+            textEdit->clearMultiCursors();
+            return;
+        }
         if (!tabPage->hasPopup())
         {
         	
@@ -705,6 +815,7 @@ void FPwin::focus_view_hard()
         		TabPage *page = qobject_cast< TabPage *>(ui->tabWidget->widget (indx));
 			TextEdit *textEdit = page->textEdit();
 			textEdit->setSearchedText (QString());
+			textEdit->setOverviewSearch (QString(), false, false);
 			QList<QTextEdit::ExtraSelection> es;
 			textEdit->setGreenSel (es);
 			es.prepend (textEdit->currentLineSelection());
@@ -892,6 +1003,7 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
                      bool uneditable,
                      bool multiple)
 {
+    TRACE_SCOPE ("FPwin::addText");
     if (fileName.isEmpty() || charset.isEmpty())
     {
         if (!fileName.isEmpty() && charset.isEmpty())
@@ -965,6 +1077,9 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     inactiveTabModified_ = true;
     textEdit->setPlainText (text);
     inactiveTabModified_ = false;
+    /* Ctrl+Home and Ctrl+End are likely jumps */
+    textEdit->prefetchLayout (0);
+    textEdit->prefetchLayout (textEdit->document()->blockCount() - 1);
     if (reload)
     {
         QTextCursor cur = textEdit->textCursor();
@@ -989,6 +1104,7 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
                 cur.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
                 int pos = qMin (qMax (cursorPos.value (fileName, 0).toInt(), 0), cur.position());
                 cur.setPosition (pos);
+                textEdit->prefetchLayout (cur.blockNumber());
                 QTimer::singleShot (0, textEdit, [textEdit, cur]() {
                     textEdit->setTextCursor (cur);
                 });
@@ -1015,6 +1131,7 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
                     cur = tmp;
                 else
                     cur.setPosition (block.position() + posInLine);
+                textEdit->prefetchLayout (restoreCursor);
                 QTimer::singleShot (0, textEdit, [textEdit, cur]() {
                     textEdit->setTextCursor (cur);
                 });
@@ -1036,29 +1153,14 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     lastFile_ = fileName;
     textEdit->setEncoding (charset);
     if (uneditable)
-    {
         connect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningUneditable, Qt::UniqueConnection);
-        textEdit->makeUneditable (uneditable);
-    }
     setTitle (fileName, (multiple && !openInCurrentTab) ?
                         ui->tabWidget->indexOf (tabPage) : -1);
     QString tip (fInfo.absolutePath());
     if (!tip.endsWith ("/")) tip += "/";
     
     if (uneditable)
-    {
-        textEdit->setReadOnly (true);
-      if (uneditable)
-            textEdit->viewport()->setStyleSheet (".QWidget {"
-                                          	"color: black;"
-                                                "background-color: rgb(225, 238, 255);}");
-       if (!multiple || openInCurrentTab)
-        {
-            ui->actionSaveAs->setDisabled (true);
-            if (config.getSaveUnmodified())
-                ui->actionSave->setDisabled (true);
-        }
-    }
+        makeUneditable (textEdit, !multiple || openInCurrentTab);
     if (!multiple || openInCurrentTab)
     {
         if (!fInfo.exists())
@@ -1118,6 +1220,23 @@ void FPwin::onPermissionDenied()
             QString("<center>You may not have the permission to read</center>"));
     });
 }
+/* Makes the document of a non-text file or a file with huge lines read-only,
+   after loading it or waking it up. The actions are updated only if the tab
+   is the current one. */
+void FPwin::makeUneditable (TextEdit *textEdit, bool current)
+{
+    textEdit->makeUneditable (true);
+    textEdit->setReadOnly (true);
+    QPalette p = textEdit->palette();
+    p.setColor (QPalette::Base, QColor (225, 238, 255));
+    textEdit->setPalette (p);
+    if (current)
+    {
+        ui->actionSaveAs->setDisabled (true);
+        if (static_cast<FPsingleton*>(qApp)->getConfig().getSaveUnmodified())
+            ui->actionSave->setDisabled (true);
+    }
+}
 void FPwin::onOpeningUneditable()
 {
     disconnect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningUneditable);
@@ -1160,6 +1279,169 @@ void FPwin::showWarningBar (const QString& message, bool startupBar)
     if (startupBar)
         bar->setObjectName ("startupBar");
 }
+void FPwin::toggleTracing()
+{
+    if (traceOverlay_ != nullptr)
+    {
+        delete traceOverlay_;
+        Tracer::setEnabled (false);
+        return;
+    }
+    Tracer::setEnabled (true);
+    traceOverlay_ = new TraceOverlay (this);
+    traceOverlay_->show();
+}
+void FPwin::dumpTrace()
+{
+    if (traceOverlay_ == nullptr) return;
+    const QString file = QDir::tempPath() + QString ("/fpad-trace-%1.json")
+                                           .arg (QCoreApplication::applicationPid());
+    traceOverlay_->setMessage (Tracer::dump (file) ? "Trace written to " + file
+                                                   : "Cannot write " + file);
+}
+/* Creates and closes empty tabs without showing them and shows how long
+   it took, for measuring the cost of a new tab. Then times toggling the
+   wrap mode and the tab size of the open tabs, once for all of them as
+   before and once with the deferred relayout of the hidden ones, the
+   frames of full-screen scrolling with and without the fast path of
+   painting, and indexing and finding the files of a bulk opening
+   (-> DocIndex). */
+void FPwin::benchmarkTabs()
+{
+    if (traceOverlay_ == nullptr || isLoading() || ui->tabWidget->count() == 0) return;
+    const int n = 100;
+    QElapsedTimer timer;
+    qint64 first = 0, rest = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        timer.start();
+        TabPage *tabPage = createEmptyTab (false);
+        const qint64 t = timer.nsecsElapsed();
+        if (i == 0)
+            first = t;
+        else
+            rest += t;
+        deleteTabPage (ui->tabWidget->indexOf (tabPage), false);
+    }
+    QString message = QString ("createEmptyTab: first %1 us, then %2 us on average")
+                      .arg (first / 1000)
+                      .arg (rest / (n - 1) / 1000);
+
+    /* each setting is toggled and restored, so pending settings would be lost */
+    QList<TextEdit*> editors;
+    QList<QPlainTextEdit::LineWrapMode> modes;
+    QList<int> tabSizes;
+    bool pending = false;
+    for (int i = 0; i < ui->tabWidget->count(); ++i)
+    {
+        TextEdit *textEdit = qobject_cast<TabPage*>(ui->tabWidget->widget (i))->textEdit();
+        editors << textEdit;
+        modes << textEdit->lineWrapMode();
+        tabSizes << textEdit->getTextTab_().length();
+        pending = pending || textEdit->hasPendingSettings();
+    }
+    if (pending)
+        message += "\nSettings toggling: skipped while settings are pending";
+    else
+    {
+        TextEdit *current = qobject_cast<TabPage*>(ui->tabWidget->currentWidget())->textEdit();
+        auto toggle = [&editors, &modes, &tabSizes, current, &timer] (bool later) {
+            timer.start();
+            for (int k = 0; k < 2; ++k) // toggle and restore
+            {
+                for (int i = 0; i < editors.size(); ++i)
+                {
+                    TextEdit *textEdit = editors.at (i);
+                    QPlainTextEdit::LineWrapMode mode = modes.at (i);
+                    int tabSize = tabSizes.at (i);
+                    if (k == 0)
+                    {
+                        mode = mode == QPlainTextEdit::NoWrap ? QPlainTextEdit::WidgetWidth
+                                                              : QPlainTextEdit::NoWrap;
+                        ++tabSize;
+                    }
+                    if (later)
+                    {
+                        textEdit->setLineWrapModeLater (mode);
+                        textEdit->setTextTabLater (tabSize);
+                    }
+                    else
+                    {
+                        textEdit->setLineWrapMode (mode);
+                        textEdit->setTtextTab (tabSize);
+                    }
+                }
+                current->applyPendingSettings();
+            }
+            return timer.nsecsElapsed() / 2;
+        };
+        const qint64 eager = toggle (false);
+        const qint64 deferred = toggle (true);
+        message += QString ("\nToggling wrap and tab size (%1 tabs): %2 ms at once, %3 ms deferred")
+                   .arg (editors.size())
+                   .arg (eager / 1000000.0, 0, 'f', 1)
+                   .arg (deferred / 1000000.0, 0, 'f', 1);
+    }
+
+    /* page by page, after a pass that lays out the pages */
+    TextEdit *textEdit = qobject_cast<TabPage*>(ui->tabWidget->currentWidget())->textEdit();
+    QScrollBar *vbar = textEdit->verticalScrollBar();
+    const int oldValue = vbar->value();
+    const int frames = 50;
+    auto scroll = [textEdit, vbar, frames, &timer] {
+        timer.start();
+        for (int i = 0; i < frames; ++i)
+        {
+            vbar->setValue (vbar->minimum()
+                            + (i * vbar->pageStep()) % (vbar->maximum() - vbar->minimum() + 1));
+            textEdit->viewport()->repaint();
+        }
+        return timer.nsecsElapsed() / frames;
+    };
+    scroll();
+    const qint64 fast = scroll();
+    TextEdit::setPlainPainting (false);
+    const qint64 slow = scroll();
+    TextEdit::setPlainPainting (true);
+    vbar->setValue (oldValue);
+    message += QString ("\nScrolling frames: %1 ms with the fast path, %2 ms without it")
+               .arg (fast / 1000000.0, 0, 'f', 2)
+               .arg (slow / 1000000.0, 0, 'f', 2);
+
+    /* the editors are only used as keys by DocIndex, so fake ones will do */
+    const int files = 1000;
+    QTemporaryDir dir;
+    QStringList names;
+    for (int i = 0; i < files; ++i)
+    {
+        QFile file (dir.filePath (QString ("%1.txt").arg (i)));
+        if (!file.open (QIODevice::WriteOnly)) break;
+        names << file.fileName();
+    }
+    if (names.size() == files)
+    {
+        auto fake = [] (int i) {
+            return reinterpret_cast<TextEdit*>(static_cast<quintptr>(i + 1) * 8);
+        };
+        timer.start();
+        for (int i = 0; i < files; ++i)
+            DocIndex::insert (fake (i), names.at (i));
+        const qint64 inserting = timer.nsecsElapsed();
+        int found = 0;
+        timer.start();
+        for (int i = 0; i < files; ++i)
+            found += DocIndex::find (names.at (i)).size();
+        const qint64 finding = timer.nsecsElapsed();
+        for (int i = 0; i < files; ++i)
+            DocIndex::remove (fake (i));
+        message += QString ("\nDocIndex (%1 files): insert %2 us, find %3 us on average%4")
+                   .arg (files)
+                   .arg (inserting / files / 1000.0, 0, 'f', 1)
+                   .arg (finding / files / 1000.0, 0, 'f', 1)
+                   .arg (found == files ? QString() : " (mismatch!)");
+    }
+    traceOverlay_->setMessage (message);
+}
 void FPwin::showCrashWarning()
 {
     QTimer::singleShot (0, this, [=]() {
@@ -1190,6 +1472,20 @@ void FPwin::newTabFromName (const QString& fileName, int restoreCursor, int posI
                   restoreCursor, posInLine,
                   false, multiple);
 }
+/* Adds a tab for a file of the last session without loading it. It is
+   loaded when it is activated (-> tabSwitch()). */
+void FPwin::newPlaceholderTab (const QString& fileName, int cursorPos)
+{
+    if (fileName.isEmpty()) return;
+    TabPage *tabPage = createEmptyTab (false);
+    tabPage->textEdit()->makePlaceholder (fileName, cursorPos);
+    const int index = ui->tabWidget->indexOf (tabPage);
+    setTitle (fileName, index);
+    updateTabTip (tabPage);
+    ui->actionReload->setEnabled (true);
+    if (ui->tabWidget->currentIndex() == index) // the first tab was already switched to
+        tabSwitch (index);
+}
 void FPwin::fileOpen()
 {
     if (isLoading()) return;
@@ -1262,25 +1558,18 @@ int FPwin::already_opened_idx (const QString& fileName, bool& modified) const
 {
 	int res = -2;
 	
-	QFileInfo info (fileName);
-	QString target = info.isSymLink() ? info.symLinkTarget()
-	    : fileName;
 	FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
 	FPwin *thisOne = singleton->Wins.at(0);
-	for (int j = 0; j < thisOne->ui->tabWidget->count(); ++j)
+	/* the editors of the same file (also through links), if any */
+	const QList<TextEdit*> textEdits = DocIndex::find (fileName);
+	for (TextEdit *thisTextEdit : textEdits)
 	{
-		TabPage *thisTabPage = qobject_cast<TabPage*>(
-		    thisOne->ui->tabWidget->widget(j));
-		TextEdit *thisTextEdit = thisTabPage->textEdit();
 		if (thisTextEdit->isReadOnly())
 			continue;
-		QFileInfo thisInfo(thisTextEdit->getFileName());
-		QString thisTarget = thisInfo.isSymLink() ?
-		    thisInfo.symLinkTarget() : thisTextEdit->getFileName();
-		if (thisTarget == target) {
+		int j = thisOne->ui->tabWidget->indexOf (thisTextEdit->parentWidget());
+		if (j > -1 && (res == -2 || j < res)) {
 			res = j;
 			modified = thisTextEdit->document()->isModified();
-			break;
 		}
 	}
     return res;
@@ -1292,6 +1581,11 @@ void FPwin::enforceEncoding (QAction*)
     if (tabPage == nullptr) return;
 
     TextEdit *textEdit = tabPage->textEdit();
+    if (textEdit->isPasting())
+    {
+        encodingToCheck (textEdit->getEncoding());
+        return;
+    }
     QString fname = textEdit->getFileName();
     if (!fname.isEmpty())
     {
@@ -1317,11 +1611,17 @@ void FPwin::reload()
 
     int index = ui->tabWidget->currentIndex();
     TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (index));
-    if (tabPage == nullptr) return;
+    if (tabPage == nullptr || tabPage->textEdit()->isPasting()) return;
+
+    TextEdit *textEdit = tabPage->textEdit();
+    if (textEdit->isHibernated())
+    { // waking up reloads the file anyway
+        wakeUp (tabPage);
+        return;
+    }
 
     if (savePrompt (index, false) != SAVED) return;
 
-    TextEdit *textEdit = tabPage->textEdit();
     QString fname = textEdit->getFileName();
     if (!QFile::exists (fname))
         deleteTabPage (index, false);
@@ -1339,6 +1639,16 @@ bool FPwin::saveFile ()
     TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (index));
     if (tabPage == nullptr) return false;
     TextEdit *textEdit = tabPage->textEdit();
+    if (textEdit->isPasting())
+    { // the text is incomplete
+        showWarningBar ("<center>Wait for the paste to finish or cancel it!</center>");
+        return false;
+    }
+    if (textEdit->isHibernated())
+    { // the document is empty until the file is reloaded
+        showWarningBar ("<center>Wait for the file to be reloaded!</center>");
+        return false;
+    }
     QString fname = textEdit->getFileName();
     QString filter = QString("All Files (*)");
     if (fname.isEmpty())
@@ -1524,6 +1834,9 @@ void FPwin::tabSwitch (int index)
         return;
     }
     TextEdit *textEdit = tabPage->textEdit();
+    textEdit->touch();
+    if (textEdit->isHibernated())
+        wakeUp (tabPage);
     if (!tabPage->isSearchBarVisible())
         textEdit->setFocus();
     QString fname = textEdit->getFileName();
@@ -1541,7 +1854,8 @@ void FPwin::tabSwitch (int index)
                                           : info.absolutePath() + "/" + fname);
         if (!QFile::exists (fname))
             onOpeningNonexistent();
-        else if (textEdit->getLastModified() != info.lastModified())
+        else if (!textEdit->isHibernated() // it is being reloaded
+                 && textEdit->getLastModified() != info.lastModified())
             showWarningBar(QString("<center>This file has been modified elsewhere!") +
                 QString("</center>\n<center>Please be careful about reloading") +
                 QString(" or saving this document!</center>"));
@@ -1580,6 +1894,122 @@ void FPwin::tabSwitch (int index)
     else
         textEdit->setReplaceTitle (QString());
 }
+/* The tab tooltip shows the memory estimates of the document. */
+void FPwin::updateTabTip (TabPage *tabPage)
+{
+    const int index = ui->tabWidget->indexOf (tabPage);
+    if (index == -1) return;
+    TextEdit *textEdit = tabPage->textEdit();
+    auto mib = [] (qint64 bytes) {
+        return QString::number (static_cast<double>(bytes) / (1 << 20), 'f', 1);
+    };
+    QStringList lines;
+    if (textEdit->getFileName().isEmpty())
+        lines << "Unsaved";
+    if (textEdit->isHibernated())
+        lines << "Hibernated";
+    else
+    {
+        lines << "Memory: ~" + mib (textEdit->memoryUsage()) + " MiB";
+        if (textEdit->undoMemory() > 0)
+            lines << "Undo history: ~" + mib (textEdit->undoMemory()) + " MiB";
+    }
+    ui->tabWidget->setTabToolTip (index, lines.join ('\n'));
+}
+/* Hibernates the unmodified background tabs of all windows that have been
+   idle for long enough, and then the longest idle ones while the memory
+   estimate of all documents is above its limit. */
+void FPwin::checkHibernation()
+{
+    FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
+    const Config& config = singleton->getConfig();
+    const qint64 idleLimit = static_cast<qint64>(config.getHibernateAfter()) * 60000;
+    const qint64 memoryLimit = static_cast<qint64>(config.getHibernateMemory()) << 20;
+    QList<QPair<FPwin*, TabPage*> > candidates;
+    qint64 total = 0;
+    for (FPwin *win : qAsConst (singleton->Wins))
+    {
+        QWidget *current = win->ui->tabWidget->currentWidget();
+        for (int i = 0; i < win->ui->tabWidget->count(); ++i)
+        {
+            TabPage *page = qobject_cast<TabPage*>(win->ui->tabWidget->widget (i));
+            if (page == nullptr) continue;
+            TextEdit *textEdit = page->textEdit();
+            if (page == current)
+                textEdit->touch();
+            else if (!win->isLoading() && textEdit->canHibernate())
+            {
+                if (idleLimit > 0 && textEdit->idleTime() >= idleLimit)
+                    textEdit->hibernate();
+                else
+                    candidates << qMakePair (win, page);
+            }
+            total += textEdit->memoryUsage();
+            win->updateTabTip (page);
+        }
+    }
+    if (memoryLimit <= 0 || total <= memoryLimit) return;
+    std::sort (candidates.begin(), candidates.end(),
+               [] (const QPair<FPwin*, TabPage*> &a, const QPair<FPwin*, TabPage*> &b) {
+        return a.second->textEdit()->idleTime() > b.second->textEdit()->idleTime();
+    });
+    for (const auto &candidate : qAsConst (candidates))
+    {
+        if (total <= memoryLimit) break;
+        TextEdit *textEdit = candidate.second->textEdit();
+        total -= textEdit->memoryUsage();
+        textEdit->hibernate();
+        candidate.first->updateTabTip (candidate.second);
+    }
+}
+/* Reloads the document of a hibernated tab with a loading thread. */
+void FPwin::wakeUp (TabPage *tabPage)
+{
+    TextEdit *textEdit = tabPage->textEdit();
+    if (textEdit->isWaking()) return;
+    textEdit->setWaking (true);
+    Loading *thread = new Loading (textEdit->getFileName(), textEdit->getEncoding(),
+                                   true, 0, 0, false, false);
+    QPointer<TabPage> page (tabPage);
+    connect (thread, &Loading::completed, this, [this, page] (const QString& text,
+                                                              const QString& fileName,
+                                                              const QString& charset,
+                                                              bool, bool, int, int,
+                                                              bool uneditable) {
+        if (page.isNull()) return;
+        TextEdit *textEdit = page->textEdit();
+        if (fileName.isEmpty() || charset.isEmpty())
+        {
+            textEdit->setWaking (false); // tried again on the next activation
+            showWarningBar ("<center>The file could not be reloaded!</center>");
+            return;
+        }
+        QFileInfo fInfo (fileName);
+        /* a placeholder has no modification time to compare (-> makePlaceholder()) */
+        const bool changed = textEdit->getLastModified().isValid()
+                             && textEdit->getLastModified() != fInfo.lastModified();
+        textEdit->setSize (fInfo.size());
+        textEdit->setLastModified (fInfo.lastModified());
+        textEdit->setEncoding (charset);
+        textEdit->wakeUp (text);
+        if (changed && ui->tabWidget->currentWidget() == page)
+            showWarningBar(QString("<center>This file has been modified elsewhere!") +
+                QString("</center>\n<center>Please be careful about") +
+                QString(" reloading or saving this document!</center>"));
+        const bool current = ui->tabWidget->currentWidget() == page;
+        if (uneditable) // the file has changed since it was opened
+            makeUneditable (textEdit, current);
+        updateTabTip (page);
+        if (current)
+        {
+            encodingToCheck (charset);
+            if (uneditable)
+                onOpeningUneditable();
+        }
+    });
+    connect (thread, &Loading::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
 void FPwin::fontDialog()
 {
     if (isLoading()) return;
@@ -1611,8 +2041,9 @@ void FPwin::fontDialog()
                 for (int j = 0; j < thisWin->ui->tabWidget->count(); ++j)
                 {
                     TextEdit *thisTextEdit = qobject_cast< TabPage *>(thisWin->ui->tabWidget->widget (j))->textEdit();
-                    thisTextEdit->setEditorFont (newFont);
+                    thisTextEdit->setEditorFontLater (newFont);
                 }
+                thisWin->schedulePendingSettings();
             }
         
         textEdit->adjustScrollbars();
@@ -1769,7 +2200,41 @@ void FPwin::toggleWrapping()
 
     bool wrapLines = ui->actionWrap->isChecked();
     for (int i = 0; i < count; ++i)
-        qobject_cast<TabPage*>(ui->tabWidget->widget (i))->textEdit()->setLineWrapMode (wrapLines ? QPlainTextEdit::WidgetWidth : QPlainTextEdit::NoWrap);
+        qobject_cast<TabPage*>(ui->tabWidget->widget (i))->textEdit()->setLineWrapModeLater (wrapLines ? QPlainTextEdit::WidgetWidth : QPlainTextEdit::NoWrap);
+    schedulePendingSettings();
+}
+/* Hidden tabs get their changed settings when they are shown. In the
+   meantime, if "backgroundRelayout" is set, they are updated one by one
+   with pauses between them and not while the user types, so that the
+   relayout of big documents doesn't freeze the window. */
+void FPwin::schedulePendingSettings()
+{
+    if (settingsScheduled_
+        || !static_cast<FPsingleton*>(qApp)->getConfig().getBackgroundRelayout())
+    {
+        return;
+    }
+    settingsScheduled_ = true;
+    QTimer::singleShot (1000, this, &FPwin::applyPendingSettings);
+}
+void FPwin::applyPendingSettings()
+{
+    settingsScheduled_ = false;
+    if (TextEdit::isTyping())
+    {
+        schedulePendingSettings();
+        return;
+    }
+    for (int i = 0; i < ui->tabWidget->count(); ++i)
+    {
+        TextEdit *textEdit = qobject_cast<TabPage*>(ui->tabWidget->widget (i))->textEdit();
+        if (textEdit->hasPendingSettings())
+        {
+            textEdit->applyPendingSettings();
+            schedulePendingSettings();
+            return;
+        }
+    }
 }
 void FPwin::toggleIndent()
 {
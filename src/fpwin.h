@@ -23,12 +23,18 @@
 #include <QListWidget>
 #include <QEvent>
 #include <QCollator>
+#include <QSharedPointer>
 #include "lineedit.h"
 #include <QMainWindow>
 #include <QActionGroup>
 #include "textedit.h"
 #include "tabpage.h"
 #include "config.h"
+#include "resultsdock.h"
+#include "textfinder.h"
+#include "filesearch.h"
+#include "filesearchdock.h"
+#include "tracer.h"
 
 namespace fpad {
 
@@ -80,6 +86,7 @@ public:
     void showCrashWarning();
     void showRootWarning();
     void updateCustomizableShortcuts (bool disable = false);
+    void schedulePendingSettings();
 
     QHash<QAction*, QKeySequence> defaultShortcuts() const {
         return defaultShortcuts_;
@@ -98,9 +105,12 @@ public slots:
                          int posInLine, // If restoreCursor > 1, this is the cursor position in the line.
                          bool multiple = false);
     void newTab();
+    void newPlaceholderTab (const QString& fileName, int cursorPos);
     void enableSaving (bool modified);
 
 private slots:
+    void applyPendingSettings();
+    void checkHibernation();
     void closeTab();
     void closeTabAtIndex (int index);
     void closeOtherTabs();
@@ -118,7 +128,25 @@ private slots:
     void tabSwitch (int index);
     void fontDialog();
     void find (bool forward);
+    void cancelIncrementalSearch();
+    void incrementalSearch();
+    void onIncrementalMatch (int id, int position, int length);
+    void findInAllTabs();
+    void onTabMatches (int id, const QVector<fpad::TextMatch>& matches);
+    void onTabSearchDone (int id);
+    void jumpToTabResult (const QVariant& key, int line, int column);
+    void findInFiles();
+    void startFileSearch (const QString& dir, const QString& pattern,
+                          bool caseSensitive, bool isRegex);
+    void stopFileSearch();
+    void onFileMatches (const QString& file, const QVector<fpad::TextMatch>& matches);
+    void onFileSearchProgress (int files, qint64 bytes, qint64 msecs);
+    void onFileSearchFinished();
+    void openFileResult (const QVariant& key, int line, int column);
     void hlight() const;
+    void toggleTracing();
+    void dumpTrace();
+    void benchmarkTabs();
     void searchFlagChanged();
     void showHideSearch();
     void toggleWrapping();
@@ -196,6 +224,9 @@ private:
     void showWarningBar (const QString& message, bool startupBar = false);
     void closeWarningBar (bool keepOnStartup = false);
     void disconnectLambda();
+    void wakeUp (TabPage *tabPage);
+    void makeUneditable (TextEdit *textEdit, bool current);
+    void updateTabTip (TabPage *tabPage);
     QActionGroup *aGroup_;
     QString lastFile_;
     QHash<QString, QVariant> lastWinFilesCur_;
@@ -209,6 +240,24 @@ private:
     QHash<QAction*, QKeySequence> defaultShortcuts_;
     bool inactiveTabModified_;
     bool standalone_;
+    bool settingsScheduled_;
+    /* incremental search */
+    QSharedPointer<QAtomicInt> incrementalCancel_;
+    QPointer<TabPage> incrementalTab_;
+    QString incrementalText_;
+    int incrementalId_;
+    int incrementalRevision_;
+    /* find in all tabs */
+    QPointer<ResultsDock> tabResultsDock_;
+    QSharedPointer<QAtomicInt> tabSearchCancel_;
+    QHash<int, QPointer<TabPage> > searchedTabs_;
+    int tabSearchId_;
+    int pendingTabSearches_;
+    /* find in files */
+    QPointer<FileSearchDock> fileResultsDock_;
+    QSharedPointer<FileSearch> fileSearch_;
+    /* the developer overlay of the tracer */
+    QPointer<TraceOverlay> traceOverlay_;
 };
 
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include "indentation.h"
+
+namespace fpad {
+
+int leadingTabsAndSpaces (const QString &text)
+{
+    const int len = text.length();
+    const QChar *data = text.constData();
+    int i = 0;
+    while (i < len && (data[i] == QLatin1Char (' ') || data[i] == QLatin1Char ('\t')))
+        ++i;
+    return i;
+}
+
+int indentLength (const QString &text)
+{
+    const int len = text.length();
+    const QChar *data = text.constData();
+    int i = 0;
+    while (i < len && data[i].isSpace())
+        ++i;
+    return i;
+}
+
+int indentColumns (const QString &text, int length, int tabSize)
+{
+    int columns = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        columns = text.at (i) == QLatin1Char ('\t') ? (columns / tabSize + 1) * tabSize
+                                                    : columns + 1;
+    }
+    return columns;
+}
+
+int unindentLength (const QString &text, int length, int tabSize, bool twoSpace)
+{
+    if (length <= 0) return 0;
+    const int columns = indentColumns (text, length, tabSize);
+    int n = columns % tabSize;
+    if (n == 0) n = tabSize;
+    if (twoSpace) n = qMin (n, 2);
+    if (text.at (length - 1) == QLatin1Char ('\t'))
+    { // the last tab is removed with the columns it doesn't cover
+        const int before = indentColumns (text, length - 1, tabSize);
+        return qMin (1 + qMax (n - (columns - before), 0), length);
+    }
+    return qMin (n, length);
+}
+
+}
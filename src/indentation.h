@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef INDENTATION_H
+#define INDENTATION_H
+
+#include <QString>
+
+namespace fpad {
+
+/* Indentation analysis of a single line (the text of a block), shared by
+   auto-indentation, smart Home and (un)indenting. Each function reads the
+   text once and doesn't need the document or its layout. */
+
+/* The number of the leading spaces and tabs. */
+int leadingTabsAndSpaces (const QString &text);
+/* The number of the leading whitespace characters. */
+int indentLength (const QString &text);
+/* The number of columns taken by the first "length" characters of an
+   indentation, with tab stops every "tabSize" columns. */
+int indentColumns (const QString &text, int length, int tabSize);
+/* How many characters should be removed from the end of an indentation of
+   "length" characters to unindent it by one tab stop, or by two spaces at
+   most if "twoSpace" is true. */
+int unindentLength (const QString &text, int length, int tabSize, bool twoSpace);
+
+}
+
+#endif // INDENTATION_H
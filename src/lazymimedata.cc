@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include "lazymimedata.h"
+
+namespace fpad {
+
+struct LazyText
+{
+    QMutex mutex;
+    QString snapshot;
+    int start;
+    int length;
+    QString text;
+    bool done;
+};
+
+/* Makes the text of the range once, in whichever thread comes first.
+   The other one waits for the mutex and finds it done. */
+static QString rangeText (LazyText *t)
+{
+    QMutexLocker locker (&t->mutex);
+    if (!t->done)
+    {
+        t->text = t->snapshot.mid (t->start, t->length); // shared if it is all of it
+        t->snapshot.clear();
+        t->done = true;
+    }
+    return t->text;
+}
+
+class CopyJob : public QRunnable
+{
+public:
+    CopyJob (const QSharedPointer<LazyText> &text) : text_ (text) {}
+    void run() override {
+        rangeText (text_.data());
+    }
+
+private:
+    QSharedPointer<LazyText> text_;
+};
+
+LazyMimeData::LazyMimeData (const QString& snapshot, int start, int end) :
+    QMimeData(),
+    text_ (new LazyText)
+{
+    start = qBound (0, start, snapshot.length());
+    end = qBound (start, end, snapshot.length());
+    text_->snapshot = snapshot;
+    text_->start = start;
+    text_->length = end - start;
+    text_->done = false;
+    if (text_->length < snapshot.length())
+        QThreadPool::globalInstance()->start (new CopyJob (text_));
+    else // nothing to copy
+        rangeText (text_.data());
+}
+
+LazyMimeData::~LazyMimeData() {}
+
+QStringList LazyMimeData::formats() const
+{
+    return QStringList (QStringLiteral ("text/plain"));
+}
+
+bool LazyMimeData::hasFormat (const QString &mimeType) const
+{
+    return mimeType == QLatin1String ("text/plain");
+}
+
+QVariant LazyMimeData::retrieveData (const QString &mimeType, QVariant::Type type) const
+{
+    if (mimeType != QLatin1String ("text/plain"))
+        return QMimeData::retrieveData (mimeType, type);
+    return QVariant (rangeText (text_.data()));
+}
+
+}
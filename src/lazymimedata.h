@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef LAZYMIMEDATA_H
+#define LAZYMIMEDATA_H
+
+#include <QMimeData>
+#include <QSharedPointer>
+
+namespace fpad {
+
+struct LazyText;
+
+/* Clipboard data for a range of a plain text snapshot. The range is
+   copied in a worker thread of the global thread pool, so that copying
+   doesn't block the editor. A request for the text, e.g., by a paste in
+   another application, waits for the copy if it isn't done yet. The
+   snapshot is released as soon as the range is copied. */
+class LazyMimeData : public QMimeData
+{
+    Q_OBJECT
+public:
+    LazyMimeData (const QString& snapshot, int start, int end);
+    ~LazyMimeData();
+
+    QStringList formats() const override;
+    bool hasFormat (const QString &mimeType) const override;
+
+protected:
+    QVariant retrieveData (const QString &mimeType, QVariant::Type type) const override;
+
+private:
+    QSharedPointer<LazyText> text_; // shared with the worker
+};
+
+}
+
+#endif // LAZYMIMEDATA_H
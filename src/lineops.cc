@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QThread>
+#include <QThreadPool>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include "lineops.h"
+
+#define MIN_SORT_CHUNK 65536 // lines; smaller inputs are sorted in one thread
+
+namespace fpad {
+
+struct OpLine {
+    QStringRef text;
+    double number; // for the numeric sorting
+};
+
+typedef std::function<bool (const OpLine&, const OpLine&)> LineLess;
+
+/* The number at the start of a line (after spaces), or -infinity, so that
+   the lines without a number come first. */
+static double leadingNumber (const QStringRef &line)
+{
+    int i = 0;
+    const int len = line.length();
+    while (i < len && line.at (i).isSpace()) ++i;
+    int j = i;
+    if (j < len && (line.at (j) == QLatin1Char ('-') || line.at (j) == QLatin1Char ('+')))
+        ++j;
+    bool digits = false, point = false;
+    while (j < len)
+    {
+        const QChar c = line.at (j);
+        if (c >= QLatin1Char ('0') && c <= QLatin1Char ('9'))
+            digits = true;
+        else if (c == QLatin1Char ('.') && !point)
+            point = true;
+        else
+            break;
+        ++j;
+    }
+    bool ok = false;
+    const double n = digits ? line.mid (i, j - i).toDouble (&ok) : 0;
+    return ok ? n : -std::numeric_limits<double>::infinity();
+}
+
+/* Compares runs of digits by their values and everything else by code
+   units, e.g., "file9" < "file10". */
+static int naturalCompare (const QStringRef &a, const QStringRef &b)
+{
+    const int la = a.length(), lb = b.length();
+    int i = 0, j = 0;
+    while (i < la && j < lb)
+    {
+        if (a.at (i).isDigit() && b.at (j).isDigit())
+        {
+            while (i < la && a.at (i) == QLatin1Char ('0')) ++i;
+            while (j < lb && b.at (j) == QLatin1Char ('0')) ++j;
+            int ei = i, ej = j;
+            while (ei < la && a.at (ei).isDigit()) ++ei;
+            while (ej < lb && b.at (ej).isDigit()) ++ej;
+            if (ei - i != ej - j)
+                return (ei - i) - (ej - j);
+            for (; i < ei; ++i, ++j)
+            {
+                if (a.at (i) != b.at (j))
+                    return a.at (i).unicode() - b.at (j).unicode();
+            }
+            continue;
+        }
+        if (a.at (i) != b.at (j))
+            return a.at (i).unicode() - b.at (j).unicode();
+        ++i; ++j;
+    }
+    return (la - i) - (lb - j);
+}
+
+class SortChunk : public QRunnable
+{
+public:
+    SortChunk (OpLine *first, OpLine *last, const LineLess &less) :
+        first_ (first), last_ (last), less_ (less) {}
+    void run() override {
+        std::stable_sort (first_, last_, less_);
+    }
+
+private:
+    OpLine *first_, *last_;
+    LineLess less_;
+};
+
+/* Sorts the chunks in a local pool (waiting for the global pool inside
+   one of its own workers could deadlock) and merges them pairwise. */
+static void parallelSort (QVector<OpLine> &lines, const LineLess &less)
+{
+    const int n = lines.size();
+    const int chunks = qBound (1, qMin (QThread::idealThreadCount(), n / MIN_SORT_CHUNK), 64);
+    OpLine *data = lines.data();
+    if (chunks == 1)
+    {
+        std::stable_sort (data, data + n, less);
+        return;
+    }
+    QVector<int> bounds;
+    for (int i = 0; i <= chunks; ++i)
+        bounds.append (static_cast<int>(static_cast<qint64>(n) * i / chunks));
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount (chunks - 1);
+        for (int i = 1; i < chunks; ++i)
+            pool.start (new SortChunk (data + bounds.at (i), data + bounds.at (i + 1), less));
+        std::stable_sort (data, data + bounds.at (1), less);
+        pool.waitForDone();
+    }
+    for (int width = 1; width < chunks; width *= 2)
+    {
+        for (int i = 0; i + width < chunks; i += 2 * width)
+        {
+            std::inplace_merge (data + bounds.at (i), data + bounds.at (i + width),
+                                data + bounds.at (qMin (i + 2 * width, chunks)), less);
+        }
+    }
+}
+
+LineOpJob::LineOpJob (int id, const QString& text, LineOperation op,
+                      const QSharedPointer<QAtomicInt>& cancel) :
+    id_ (id),
+    text_ (text),
+    op_ (op),
+    cancel_ (cancel)
+{
+    setAutoDelete (false); // deleteLater() in run() -> deleted in the GUI thread
+}
+
+LineOpJob::~LineOpJob() {}
+
+void LineOpJob::run()
+{
+    const QChar sep (QChar::ParagraphSeparator);
+    const QVector<QStringRef> refs = text_.splitRef (sep);
+    QVector<OpLine> lines;
+    lines.reserve (refs.size());
+    for (const auto &ref : refs)
+    {
+        const OpLine line = {ref, 0};
+        lines.append (line);
+    }
+
+    switch (op_) {
+    case SortLines:
+        parallelSort (lines, [] (const OpLine &a, const OpLine &b) {
+            return a.text.compare (b.text, Qt::CaseSensitive) < 0;
+        });
+        break;
+    case SortLinesCaseInsensitively:
+        parallelSort (lines, [] (const OpLine &a, const OpLine &b) {
+            return a.text.compare (b.text, Qt::CaseInsensitive) < 0;
+        });
+        break;
+    case SortLinesNumerically:
+        for (auto &line : lines)
+            line.number = leadingNumber (line.text);
+        parallelSort (lines, [] (const OpLine &a, const OpLine &b) {
+            return a.number < b.number;
+        });
+        break;
+    case SortLinesNaturally:
+        parallelSort (lines, [] (const OpLine &a, const OpLine &b) {
+            return naturalCompare (a.text, b.text) < 0;
+        });
+        break;
+    case RemoveDuplicateLines: {
+        QSet<QStringRef> seen;
+        seen.reserve (lines.size());
+        QVector<OpLine> unique;
+        for (const auto &line : qAsConst (lines))
+        {
+            if (!seen.contains (line.text))
+            {
+                seen.insert (line.text);
+                unique.append (line);
+            }
+        }
+        lines.swap (unique);
+        break;
+    }
+    case ReverseLines:
+        std::reverse (lines.begin(), lines.end());
+        break;
+    case ShuffleLines:
+        std::shuffle (lines.begin(), lines.end(), std::mt19937 (std::random_device()()));
+        break;
+    case TrimTrailingSpaces:
+        for (auto &line : lines)
+        {
+            int len = line.text.length();
+            while (len > 0 && line.text.at (len - 1).isSpace()) --len;
+            line.text = line.text.left (len);
+        }
+        break;
+    }
+
+    if (cancel_->load() == 0)
+    {
+        qint64 size = 0;
+        for (const auto &line : qAsConst (lines))
+            size += line.text.length() + 1;
+        QString result;
+        result.reserve (static_cast<int>(qMax (size - 1, Q_INT64_C (0))));
+        for (int i = 0; i < lines.size(); ++i)
+        {
+            if (i > 0) result += QLatin1Char ('\n');
+            result += lines.at (i).text;
+        }
+        lines.clear();
+        text_.clear();
+        if (cancel_->load() == 0)
+            emit done (id_, result);
+    }
+    deleteLater();
+}
+
+}
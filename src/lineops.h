@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef LINEOPS_H
+#define LINEOPS_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QAtomicInt>
+
+namespace fpad {
+
+enum LineOperation {
+    SortLines,
+    SortLinesNumerically,
+    SortLinesNaturally,
+    SortLinesCaseInsensitively,
+    RemoveDuplicateLines,
+    ReverseLines,
+    ShuffleLines,
+    TrimTrailingSpaces
+};
+
+/* Applies a line operation to a text snapshot in a worker thread of the
+   global thread pool. The lines of the text are separated by paragraph
+   separators, as in QTextCursor::selectedText(), and those of the result
+   by newlines. Sorting is stable and is split between the cores. The job
+   deletes itself. */
+class LineOpJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    LineOpJob (int id, const QString& text, LineOperation op,
+               const QSharedPointer<QAtomicInt>& cancel);
+    ~LineOpJob();
+
+    void run() override;
+
+signals:
+    /* Not emitted if canceled. */
+    void done (int id, const QString& result);
+
+private:
+    int id_;
+    QString text_;
+    LineOperation op_;
+    QSharedPointer<QAtomicInt> cancel_;
+};
+
+}
+
+#endif // LINEOPS_H
@@ -18,12 +18,58 @@
  */
 
 #include "loading.h"
+#include "tracer.h"
 #include "encoding.h"
 #include <QFile>
 #include <QTextCodec>
 
+/* Longer lines are truncated and make the document uneditable because
+   QPlainTextDocumentLayout lays out each block as a whole. A multiple
+   of 4 is used for UTF-16/32. */
+#define HUGE_LINE 500000
+#define HUGE_LINE_UNITS 500004
+
 namespace fpad {
 
+/* Removes the bytes of each line after its first "limit" bytes and puts
+   "marker" in their place. "num" is the number of bytes of the first line
+   that are before "data". Returns true if a line is truncated. Nothing is
+   copied if there is no huge line. */
+static bool truncateHugeLines (QByteArray& data, int num, int limit, const QByteArray& marker)
+{
+    const int size = data.size();
+    const char *p = data.constData();
+    int i = 0;
+    auto findHugeLine = [p, size, limit, &i, &num] {
+        for (; i < size; ++i)
+        {
+            if (p[i] == '\n' || p[i] == '\r')
+                num = 0;
+            else if (++num > limit)
+                break;
+        }
+    };
+    findHugeLine();
+    if (i == size) return false;
+
+    QByteArray res;
+    res.reserve (size);
+    int start = 0; // the first byte that is not added yet
+    while (i < size)
+    {
+        res.append (p + start, i - start);
+        res.append (marker);
+        while (i < size && p[i] != '\n' && p[i] != '\r')
+            ++i;
+        start = i;
+        num = 0;
+        findHugeLine();
+    }
+    res.append (p + start, size - start);
+    data = res;
+    return true;
+}
+
 Loading::Loading (const QString& fname, const QString& charset, bool reload,
                   int restoreCursor, int posInLine,
                   bool forceUneditable, bool multiple) :
@@ -40,6 +86,7 @@ Loading::~Loading() {}
 
 void Loading::run()
 {
+    TRACE_SCOPE ("Loading::run");
     if (!QFile::exists (fname_))
     {
         emit completed (QString(), fname_,
@@ -60,8 +107,9 @@ void Loading::run()
         return;
     }
 
-    /* read the file character by character to know
-       if it includes null (and because that's faster) */
+    /* read the first 4 bytes character by character to guess the encoding
+       and then the rest at once, checking if the file includes null
+       and truncating huge lines */
     bool enforced = !charset_.isEmpty();
     bool hasNull = false;
     QByteArray data;
@@ -70,16 +118,9 @@ void Loading::run()
     int num = 0;
     if (enforced)
     { // no need to check for the null character here
-        while (file.read (&c, charSize) > 0)
-        {
-            if (c == '\n' || c == '\r')
-                num = 0;
-            if (num < 500004) // a multiple of 4 (for UTF-16/32)
-                data.append (c);
-            else
-                forceUneditable_ = true;
-            ++num;
-        }
+        data = file.readAll();
+        if (truncateHugeLines (data, 0, HUGE_LINE_UNITS, QByteArray()))
+            forceUneditable_ = true;
     }
     else
     {
@@ -116,44 +157,18 @@ void Loading::run()
                 }
             }
             /* reading may still be possible */
-            if (charset_.isEmpty() && !hasNull)
+            QByteArray rest = file.readAll();
+            bool truncated;
+            if (charset_.isEmpty() && !hasNull && !(hasNull = rest.contains ('\0')))
             {
-                num = 5; // 4 characters are already read
-                while (file.read (&c, charSize) > 0)
-                {
-                    if (c == '\0')
-                    {
-                        if (!hasNull)
-                        {
-                            hasNull = true;
-                        }
-                    }
-                    else if (c == '\n' || c == '\r')
-                        num = 0;
-                    if (num <= 500000)
-                        data.append (c);
-                    else if (num == 500001)
-                    {
-                        data += QByteArray ("    HUGE LINE TRUNCATED: NO LINE WITH MORE THAN 500000 CHARACTERS");
-                        forceUneditable_ = true;
-                    }
-                    ++num;
-                }
+                truncated = truncateHugeLines (rest, num, HUGE_LINE,
+                                               QByteArray ("    HUGE LINE TRUNCATED: NO LINE WITH MORE THAN 500000 CHARACTERS"));
             }
             else
-            {
-                num = 0;
-                while (file.read (&c, charSize) > 0)
-                {
-                    if (c == '\n' || c == '\r')
-                        num = 0;
-                    if (num < 500004)
-                        data.append (c);
-                    else
-                        forceUneditable_ = true;
-                    ++num;
-                }
-            }
+                truncated = truncateHugeLines (rest, 0, HUGE_LINE_UNITS, QByteArray());
+            if (truncated)
+                forceUneditable_ = true;
+            data += rest;
         }
     }
     file.close();
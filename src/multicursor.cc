@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QApplication>
+#include <QClipboard>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QPainter>
+#include <QKeyEvent>
+#include <QtMath>
+#include <algorithm>
+#include "textedit.h"
+
+/* The multi-cursor mode of TextEdit. The cursors are kept as positions
+   instead of QTextCursor objects because the document adjusts every
+   QTextCursor on every change, which is too slow with thousands of them.
+   All cursors are edited in one edit block, from the last to the first,
+   so that the positions of the earlier ones remain valid and the edit
+   is a single undo step. */
+
+namespace fpad {
+
+void TextEdit::clearMultiCursors()
+{
+    if (cursors_.isEmpty()) return;
+    QVector<MultiCursor> old;
+    old.swap (cursors_);
+    updateCursorRows (old);
+}
+
+/* Sorts and merges the cursors, makes the last one the text cursor and
+   repaints the visible rows whose cursors have changed. */
+void TextEdit::setMultiCursors (QVector<MultiCursor> cursors)
+{
+    std::sort (cursors.begin(), cursors.end(), [] (const MultiCursor &a, const MultiCursor &b) {
+        return qMin (a.anchor, a.position) < qMin (b.anchor, b.position);
+    });
+    QVector<MultiCursor> merged;
+    merged.reserve (cursors.size());
+    for (const auto &c : qAsConst (cursors))
+    {
+        if (!merged.isEmpty())
+        {
+            const MultiCursor &prev = merged.last();
+            const int start = qMin (c.anchor, c.position);
+            const int prevEnd = qMax (prev.anchor, prev.position);
+            /* overlapping, or touching with an empty cursor, which
+               could delete from the other one */
+            if (start < prevEnd
+                || (start == prevEnd && (c.anchor == c.position || prev.anchor == prev.position)))
+            {
+                continue;
+            }
+        }
+        merged.append (c);
+    }
+
+    QVector<MultiCursor> old;
+    old.swap (cursors_);
+    if (merged.size() > 1)
+        cursors_ = merged;
+    if (!merged.isEmpty())
+    {
+        multiEditing_ = true;
+        QTextCursor cursor = textCursor();
+        cursor.setPosition (merged.last().anchor);
+        cursor.setPosition (merged.last().position, QTextCursor::KeepAnchor);
+        setTextCursor (cursor);
+        multiEditing_ = false;
+    }
+    updateCursorRows (old);
+    updateCursorRows (cursors_);
+}
+
+/* Returns true if the key is handled in the multi-cursor mode. Other
+   keys end the mode, except for the modifiers, which arrive before the
+   keys they modify, and the clipboard and undo shortcuts, which have
+   their own multi-cursor handling (-> keyPressEvent()). */
+bool TextEdit::multiCursorKey (QKeyEvent *event)
+{
+    if (event == QKeySequence::Copy || event == QKeySequence::Cut
+        || event == QKeySequence::Paste || event == QKeySequence::Undo
+        || event == QKeySequence::Redo)
+    {
+        return false;
+    }
+    const Qt::KeyboardModifiers mods = event->modifiers() & ~Qt::KeypadModifier;
+    switch (event->key()) {
+    case Qt::Key_Shift:
+    case Qt::Key_Control:
+    case Qt::Key_Alt:
+    case Qt::Key_AltGr:
+    case Qt::Key_Meta:
+    case Qt::Key_Super_L:
+    case Qt::Key_Super_R:
+    case Qt::Key_CapsLock:
+    case Qt::Key_NumLock:
+        return true;
+    case Qt::Key_Escape:
+        clearMultiCursors();
+        return true;
+    case Qt::Key_Backspace:
+        multiCursorEdit (QStringList (QString()), -1);
+        return true;
+    case Qt::Key_Delete:
+        multiCursorEdit (QStringList (QString()), 1);
+        return true;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        multiCursorEdit (QStringList (QString ("\n")));
+        return true;
+    case Qt::Key_Tab:
+        multiCursorEdit (QStringList (QString ("\t")));
+        return true;
+    case Qt::Key_H:
+    case Qt::Key_L:
+        if (mods == Qt::AltModifier || mods == (Qt::AltModifier | Qt::ShiftModifier))
+        {
+            moveMultiCursors (event->key() == Qt::Key_H ? -1 : 1, mods.testFlag (Qt::ShiftModifier));
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    const QString text = event->text();
+    if (!text.isEmpty() && text.at (0).isPrint()
+        && !(mods & (Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier)))
+    {
+        multiCursorEdit (QStringList (text));
+        return true;
+    }
+    clearMultiCursors();
+    return false;
+}
+
+/* Replaces the selection of each cursor with the text, or with the text
+   at the same index if there is one text per cursor. If a cursor has no
+   selection, "deletion" removes the character before (-1) or after (1)
+   it, but not a block separator, so that the rows stay aligned. */
+void TextEdit::multiCursorEdit (const QStringList &texts, int deletion)
+{
+    const int n = cursors_.size();
+    if (n == 0) return;
+    keepTxtCurHPos_ = false;
+    txtCurHPos_ = -1;
+    QVector<int> starts (n), lengths (n), deltas (n);
+    multiEditing_ = true;
+    QTextCursor cursor (document());
+    cursor.beginEditBlock();
+    for (int i = n - 1; i >= 0; --i)
+    {
+        const MultiCursor &c = cursors_.at (i);
+        int start = qMin (c.anchor, c.position);
+        int end = qMax (c.anchor, c.position);
+        if (start == end && deletion != 0)
+        {
+            const QTextBlock block = document()->findBlock (start);
+            if (deletion < 0 && start > block.position())
+                --start;
+            else if (deletion > 0 && end < block.position() + block.length() - 1)
+                ++end;
+        }
+        const QString text = texts.size() == n ? texts.at (i) : texts.value (0);
+        if (start != end || !text.isEmpty())
+        {
+            cursor.setPosition (start);
+            cursor.setPosition (end, QTextCursor::KeepAnchor);
+            cursor.insertText (text);
+        }
+        starts[i] = start;
+        lengths[i] = text.length();
+        deltas[i] = text.length() - (end - start);
+    }
+    cursor.endEditBlock();
+    multiEditing_ = false;
+
+    QVector<MultiCursor> cursors (n);
+    int shift = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const int pos = starts.at (i) + shift + lengths.at (i);
+        cursors[i].anchor = cursors[i].position = pos;
+        shift += deltas.at (i);
+    }
+    setMultiCursors (cursors);
+    ensureCursorVisible();
+}
+
+void TextEdit::moveMultiCursors (int step, bool keepAnchor)
+{
+    QVector<MultiCursor> cursors = cursors_;
+    for (auto &c : cursors)
+    {
+        const QTextBlock block = document()->findBlock (c.position);
+        c.position = qBound (block.position(), c.position + step,
+                             block.position() + block.length() - 1);
+        if (!keepAnchor)
+            c.anchor = c.position;
+    }
+    setMultiCursors (cursors);
+}
+
+/* Adds a cursor in the next or previous row, at the columns of the last
+   or first cursor (-> Alt+Shift+Down/Up). */
+void TextEdit::addCursorRow (bool down)
+{
+    QVector<MultiCursor> cursors = cursors_;
+    if (cursors.isEmpty())
+    {
+        QTextCursor cursor = textCursor();
+        MultiCursor c;
+        c.position = cursor.position();
+        c.anchor = cursor.block() == document()->findBlock (cursor.anchor()) ? cursor.anchor()
+                                                                             : c.position;
+        cursors.append (c);
+    }
+    const MultiCursor base = down ? cursors.last() : cursors.first();
+    const QTextBlock block = document()->findBlock (base.position);
+    const QTextBlock row = down ? block.next() : block.previous();
+    if (!row.isValid()) return;
+    const int maxColumn = row.length() - 1;
+    MultiCursor c;
+    c.anchor = row.position() + qMin (base.anchor - block.position(), maxColumn);
+    c.position = row.position() + qMin (base.position - block.position(), maxColumn);
+    cursors.append (c);
+    setMultiCursors (cursors);
+    ensureCursorVisible();
+}
+
+/* Makes a cursor in each row between the anchor and the point, selecting
+   the same character columns (-> Alt+drag). */
+void TextEdit::setRectangle (int anchorBlock, int anchorColumn, const QPoint &pos)
+{
+    const QTextCursor cur = cursorForPosition (pos);
+    const int posBlock = cur.blockNumber();
+    const int posColumn = cur.positionInBlock();
+    QVector<MultiCursor> cursors;
+    cursors.reserve (qAbs (posBlock - anchorBlock) + 1);
+    QTextBlock block = document()->findBlockByNumber (qMin (anchorBlock, posBlock));
+    const int last = qMax (anchorBlock, posBlock);
+    while (block.isValid() && block.blockNumber() <= last)
+    {
+        const int maxColumn = block.length() - 1;
+        MultiCursor c;
+        c.anchor = block.position() + qMin (anchorColumn, maxColumn);
+        c.position = block.position() + qMin (posColumn, maxColumn);
+        cursors.append (c);
+        block = block.next();
+    }
+    if (cursors.size() == 1)
+    { // a normal selection
+        clearMultiCursors();
+        QTextCursor cursor = textCursor();
+        cursor.setPosition (cursors.first().anchor);
+        cursor.setPosition (cursors.first().position, QTextCursor::KeepAnchor);
+        setTextCursor (cursor);
+        return;
+    }
+    setMultiCursors (cursors);
+}
+
+/* The selected texts of the cursors, one per line. */
+QString TextEdit::multiCursorText() const
+{
+    QString text;
+    QTextCursor cursor (document());
+    for (int i = 0; i < cursors_.size(); ++i)
+    {
+        if (i > 0)
+            text += QLatin1Char ('\n');
+        cursor.setPosition (cursors_.at (i).anchor);
+        cursor.setPosition (cursors_.at (i).position, QTextCursor::KeepAnchor);
+        text += cursor.selectedText();
+    }
+    return text;
+}
+
+/* Repaints only the visible rows of the given cursors. */
+void TextEdit::updateCursorRows (const QVector<MultiCursor> &cursors)
+{
+    if (cursors.isEmpty()) return;
+    QTextBlock block = firstVisibleBlock();
+    if (!block.isValid()) return;
+    const QPointF offset = contentOffset();
+    const int h = viewport()->height();
+    const int w = viewport()->width();
+    auto it = std::lower_bound (cursors.constBegin(), cursors.constEnd(), block.position(),
+                                [] (const MultiCursor &c, int pos) {
+        return qMax (c.anchor, c.position) < pos;
+    });
+    while (block.isValid() && it != cursors.constEnd())
+    {
+        const QRectF r = blockBoundingGeometry (block).translated (offset);
+        if (r.top() > h) break;
+        const int end = block.position() + block.length();
+        bool hasCursor = false;
+        while (it != cursors.constEnd() && qMin (it->anchor, it->position) < end)
+        {
+            hasCursor = true;
+            ++it;
+        }
+        if (hasCursor)
+            viewport()->update (QRect (0, static_cast<int>(r.top()), w, qCeil (r.height())));
+        block = block.next();
+    }
+}
+
+/* Draws the selections and cursors that are in the visible blocks,
+   except for the text cursor, which QPlainTextEdit draws. */
+void TextEdit::drawMultiCursors (QPainter *painter)
+{
+    QTextBlock block = firstVisibleBlock();
+    if (!block.isValid()) return;
+    QPointF offset = contentOffset();
+    const int h = viewport()->height();
+    QColor selColor = palette().color (QPalette::Highlight);
+    selColor.setAlpha (120);
+    QColor curColor = palette().color (QPalette::Text);
+    curColor.setAlpha (140);
+    auto it = std::lower_bound (cursors_.constBegin(), cursors_.constEnd() - 1, block.position(),
+                                [] (const MultiCursor &c, int pos) {
+        return qMax (c.anchor, c.position) < pos;
+    });
+    while (block.isValid() && it != cursors_.constEnd() - 1)
+    {
+        const QRectF r = blockBoundingGeometry (block).translated (offset);
+        if (r.top() > h) break;
+        const int blockPos = block.position();
+        const int end = blockPos + block.length();
+        QTextLayout *layout = block.layout();
+        while (it != cursors_.constEnd() - 1 && qMin (it->anchor, it->position) < end)
+        {
+            const int s = qMin (it->anchor, it->position) - blockPos;
+            const int e = qMax (it->anchor, it->position) - blockPos;
+            for (int l = 0; l < layout->lineCount(); ++l)
+            {
+                const QTextLine line = layout->lineAt (l);
+                const int lineStart = line.textStart();
+                const int lineEnd = lineStart + line.textLength();
+                const qreal top = r.top() + line.y();
+                if (e > s && s <= lineEnd && e >= lineStart)
+                {
+                    const qreal x1 = line.cursorToX (qMax (s, lineStart));
+                    const qreal x2 = line.cursorToX (qMin (e, lineEnd));
+                    painter->fillRect (QRectF (offset.x() + qMin (x1, x2), top,
+                                               qAbs (x2 - x1), line.height()), selColor);
+                }
+                const int p = it->position - blockPos;
+                if (p >= lineStart && (p < lineEnd || l == layout->lineCount() - 1))
+                {
+                    const qreal x = line.cursorToX (p);
+                    painter->fillRect (QRectF (offset.x() + x, top, 2, line.height()), curColor);
+                }
+            }
+            ++it;
+        }
+        block = block.next();
+    }
+}
+
+}
@@ -437,8 +437,18 @@ void PrefDialog::prefTextTabSize (int value)
 }
 void PrefDialog::prefTextTab()
 {
-    Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
+    FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
+    Config& config = singleton->getConfig();
+    if (config.getTextTabSize() == textTabSize_)
+        return;
     config.setTextTabSize (textTabSize_);
+    for (int i = 0; i < singleton->Wins.count(); ++i)
+    {
+        FPwin *win = singleton->Wins.at (i);
+        for (int j = 0; j < win->ui->tabWidget->count(); ++j)
+            qobject_cast< TabPage *>(win->ui->tabWidget->widget (j))->textEdit()->setTextTabLater (textTabSize_);
+        win->schedulePendingSettings();
+    }
 }
 
 }
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include <QVBoxLayout>
+#include "resultsdock.h"
+#include "theme.h"
+
+#define MAX_RESULTS 50000
+
+namespace fpad {
+
+ResultsDock::ResultsDock (const QString& title, QWidget *parent)
+    : QDockWidget (title, parent)
+{
+    setObjectName (title);
+    setAllowedAreas (Qt::BottomDockWidgetArea | Qt::TopDockWidgetArea);
+    setFeatures (QDockWidget::DockWidgetClosable | QDockWidget::DockWidgetMovable
+                 | QDockWidget::DockWidgetFloatable);
+    setStyleSheet (
+        "background-color: " STR(WIDGETS_BG) ";"
+        "color: " STR(WIDGETS_FG) ";"
+    );
+
+    contents_ = new QWidget (this);
+    list_ = new QListWidget (contents_);
+    list_->setUniformItemSizes (true); // much faster with many items
+    list_->setFont (QFont ("Monospace"));
+    status_ = new QLabel (contents_);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->setContentsMargins (2, 2, 2, 2);
+    layout->setSpacing (2);
+    layout->addWidget (list_);
+    layout->addWidget (status_);
+    contents_->setLayout (layout);
+    setWidget (contents_);
+
+    connect (list_, &QListWidget::itemActivated, this, [this] (QListWidgetItem *item) {
+        if (item == nullptr) return;
+        emit resultActivated (item->data (Qt::UserRole),
+                              item->data (Qt::UserRole + 1).toInt(),
+                              item->data (Qt::UserRole + 2).toInt());
+    });
+    connect (list_, &QListWidget::itemClicked, list_, &QListWidget::itemActivated);
+}
+
+void ResultsDock::clearResults()
+{
+    list_->clear();
+    status_->clear();
+}
+
+bool ResultsDock::addResult (const QString& text, const QVariant& key, int line, int column)
+{
+    if (list_->count() >= MAX_RESULTS)
+        return false;
+    QListWidgetItem *item = new QListWidgetItem (text);
+    item->setData (Qt::UserRole, key);
+    item->setData (Qt::UserRole + 1, line);
+    item->setData (Qt::UserRole + 2, column);
+    list_->addItem (item);
+    return true;
+}
+
+int ResultsDock::resultCount() const
+{
+    return list_->count();
+}
+
+void ResultsDock::setStatus (const QString& status)
+{
+    status_->setText (status);
+}
+
+}
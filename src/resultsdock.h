@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef RESULTSDOCK_H
+#define RESULTSDOCK_H
+
+#include <QDockWidget>
+#include <QListWidget>
+#include <QLabel>
+#include <QPointer>
+
+namespace fpad {
+
+/* A dock that lists search results and reports the activated one. */
+class ResultsDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    ResultsDock (const QString& title, QWidget *parent = nullptr);
+
+    void clearResults();
+    /* Returns false if there is no room for more results. */
+    bool addResult (const QString& text, const QVariant& key, int line, int column);
+    int resultCount() const;
+    void setStatus (const QString& status);
+
+signals:
+    void resultActivated (const QVariant& key, int line, int column);
+
+protected:
+    QWidget *contents() const {
+        return contents_;
+    }
+
+private:
+    QPointer<QWidget> contents_;
+    QPointer<QListWidget> list_;
+    QPointer<QLabel> status_;
+};
+
+}
+
+#endif // RESULTSDOCK_H
@@ -24,6 +24,7 @@
 namespace fpad {
 
 static const int MAX_ROW_COUNT = 40;
+static const int INCREMENTAL_DELAY = 200; // in ms
 
 void ComboBox::keyPressEvent (QKeyEvent *event)
 {
@@ -135,6 +136,15 @@ SearchBar::SearchBar(QWidget *parent,
     mainGrid->addWidget (button_case_, 0, 4);
     mainGrid->addWidget (button_regex_, 0, 6);
     setLayout (mainGrid);
+    /* search as you type, but only after a pause in typing */
+    incrementalTimer_ = new QTimer (this);
+    incrementalTimer_->setSingleShot (true);
+    incrementalTimer_->setInterval (INCREMENTAL_DELAY);
+    connect (incrementalTimer_, &QTimer::timeout, this, &SearchBar::incrementalSearch);
+    connect (lineEdit_, &QLineEdit::textEdited, this, [this] {
+        emit searchTextEdited();
+        incrementalTimer_->start();
+    });
     connect (lineEdit_, &QLineEdit::returnPressed, this, &SearchBar::findForward);
     connect (lineEdit_, &fpad::LineEdit::shift_enter_pressed, this, &SearchBar::findBackward);
     connect (toolButton_nxt_, &QAbstractButton::clicked, this, &SearchBar::findForward);
@@ -207,12 +217,14 @@ void SearchBar::clearSearchEntry()
 
 void SearchBar::findForward()
 {
+    incrementalTimer_->stop();
     searchStarted();
     emit find (true);
 }
 
 void SearchBar::findBackward()
 {
+    incrementalTimer_->stop();
     searchStarted();
     emit find (false);
 }
@@ -21,6 +21,7 @@
 #define SEARCHBAR_H
 
 #include <QPointer>
+#include <QTimer>
 #include <QToolButton>
 #include <QComboBox>
 #include <QStandardItemModel>
@@ -73,6 +74,9 @@ public:
 signals:
     void searchFlagChanged();
     void find (bool forward);
+    /* emitted on each edit, before "incrementalSearch()" is emitted with a delay */
+    void searchTextEdited();
+    void incrementalSearch();
 
 private:
     void searchStarted();
@@ -85,6 +89,7 @@ private:
     QPointer<QToolButton> toolButton_prv_;
     QPointer<QToolButton> button_case_;
     QPointer<QToolButton> button_regex_;
+    QTimer *incrementalTimer_;
     QList<QKeySequence> shortcuts_;
     bool searchStarted_;
     QString searchText_;
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include <QFile>
+#include <QTextCodec>
+#include "searchjob.h"
+#include "encoding.h"
+
+#define BATCH_SIZE 256
+#define MAX_MATCHES_PER_TEXT 10000
+
+namespace fpad {
+
+SearchJob::SearchJob (int id, const QString& text,
+                      const QString& pattern, bool caseSensitive, bool isRegex,
+                      const QSharedPointer<QAtomicInt>& cancel) :
+    id_ (id),
+    text_ (text),
+    finder_ (pattern, caseSensitive, isRegex),
+    cancel_ (cancel)
+{
+    static const int registered = qRegisterMetaType<QVector<fpad::TextMatch> >();
+    Q_UNUSED (registered);
+    setAutoDelete (false); // deleteLater() in run() -> deleted in the GUI thread
+}
+
+SearchJob::~SearchJob() {}
+
+void SearchJob::setFile (const QString& fileName, const QString& charset)
+{
+    fileName_ = fileName;
+    charset_ = charset;
+}
+
+static QString readText (const QString& fileName, const QString& charset)
+{
+    QFile file (fileName);
+    if (!file.open (QFile::ReadOnly))
+        return QString();
+    const QByteArray data = file.readAll();
+    file.close();
+    QTextCodec *codec = QTextCodec::codecForName ((charset.isEmpty() ? detectCharset (data)
+                                                                     : charset).toUtf8());
+    if (codec == nullptr)
+        codec = QTextCodec::codecForName ("UTF-8");
+    QString text = codec->toUnicode (data);
+    /* as in the document */
+    text.replace (QLatin1String ("\r\n"), QLatin1String ("\n"));
+    text.replace (QLatin1Char ('\r'), QLatin1Char ('\n'));
+    return text;
+}
+
+void SearchJob::run()
+{
+    if (!fileName_.isEmpty() && cancel_->load() == 0)
+        text_ = readText (fileName_, charset_);
+    if (cancel_->load() == 0)
+    {
+        const QVector<TextMatch> matches = finder_.findAll (text_, cancel_.data(),
+                                                            MAX_MATCHES_PER_TEXT);
+        text_.clear(); // release the snapshot as soon as possible
+        for (int i = 0; i < matches.size() && cancel_->load() == 0; i += BATCH_SIZE)
+            emit found (id_, matches.mid (i, BATCH_SIZE));
+    }
+    emit done (id_);
+    deleteLater();
+}
+
+FirstMatchJob::FirstMatchJob (int id, const QString& text, int from,
+                              const QString& pattern, bool caseSensitive, bool isRegex,
+                              const QSharedPointer<QAtomicInt>& cancel) :
+    id_ (id),
+    text_ (text),
+    from_ (from),
+    finder_ (pattern, caseSensitive, isRegex),
+    cancel_ (cancel)
+{
+    setAutoDelete (false);
+}
+
+FirstMatchJob::~FirstMatchJob() {}
+
+void FirstMatchJob::run()
+{
+    int len = 0;
+    int indx = finder_.indexIn (text_, from_, &len, cancel_.data());
+    if (indx == -1 && from_ > 0 && cancel_->load() == 0)
+    {
+        indx = finder_.indexIn (text_, 0, &len, cancel_.data());
+        if (indx >= from_) // not found before "from_" either
+            indx = -1;
+    }
+    text_.clear();
+    if (cancel_->load() == 0)
+        emit found (id_, indx, len);
+    deleteLater();
+}
+
+}
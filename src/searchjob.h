@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef SEARCHJOB_H
+#define SEARCHJOB_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include "textfinder.h"
+
+namespace fpad {
+
+/* Searches a text snapshot in a worker thread of the global thread pool.
+   Results are sent in batches. The job deletes itself after the search.
+   If a file is set, it is searched instead of the text (-> setFile()). */
+class SearchJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    SearchJob (int id, const QString& text,
+               const QString& pattern, bool caseSensitive, bool isRegex,
+               const QSharedPointer<QAtomicInt>& cancel);
+    ~SearchJob();
+
+    /* For documents that aren't loaded (hibernated tabs). The file is
+       read and decoded like Loading::run() does, with the detected
+       charset if "charset" is empty. */
+    void setFile (const QString& fileName, const QString& charset);
+
+    void run() override;
+
+signals:
+    void found (int id, const QVector<fpad::TextMatch>& matches);
+    void done (int id);
+
+private:
+    int id_;
+    QString text_;
+    QString fileName_;
+    QString charset_;
+    TextFinder finder_;
+    QSharedPointer<QAtomicInt> cancel_;
+};
+
+/* Finds the first match at or after a position in a text snapshot, wrapping
+   around the end, for the incremental search. It deletes itself too. */
+class FirstMatchJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    FirstMatchJob (int id, const QString& text, int from,
+                   const QString& pattern, bool caseSensitive, bool isRegex,
+                   const QSharedPointer<QAtomicInt>& cancel);
+    ~FirstMatchJob();
+
+    void run() override;
+
+signals:
+    /* "position" is -1 if there is no match. Not emitted if canceled. */
+    void found (int id, int position, int length);
+
+private:
+    int id_;
+    QString text_;
+    int from_;
+    TextFinder finder_;
+    QSharedPointer<QAtomicInt> cancel_;
+};
+
+}
+
+#endif // SEARCHJOB_H
@@ -24,6 +24,7 @@
 #include <QTextBlock>
 #include <QCryptographicHash>
 #include <QThread>
+#include <QSharedPointer>
 
 #if defined Q_OS_LINUX || defined Q_OS_FREEBSD || defined Q_OS_OPENBSD || defined Q_OS_NETBSD || defined Q_OS_HURD
 #include <unistd.h>
@@ -250,6 +251,20 @@ FPwin* FPsingleton::newWin (QString pwd, const QStringList& filesList)
 	else
 		goto end;
 	multiple = files->count() > 1 || fp->isLoading();
+	if (files == &lastFiles_) {
+		/* the last session is restored lazily */
+		const QHash<QString, QVariant> cursorPos = config_.getLastFilesCursorPos();
+		for (int i = 0; i < files->count(); ++i){
+			QString filename = files->at(i);
+			int lineNum = 0, posInLine = 0;
+			QString realPath;
+			cursorInfo(pwd, filename, lineNum, posInLine, realPath);
+			if (!check_file_exists(realPath))
+				continue;
+			fp->newPlaceholderTab(realPath, cursorPos.value(filename, 0).toInt());
+		}
+		goto end;
+	}
 	for (int i = 0; i < files->count(); ++i){
         	QString filename = files->at(i);
         	int lineNum = 0, posInLine = 0;
@@ -269,6 +284,26 @@ void FPsingleton::removeWin (FPwin *win)
     win->deleteLater();
 }
 
+static void
+moveToLine(TextEdit *textEdit, int lineNum, int posInLine)
+{
+	QTextCursor curs = textEdit->textCursor();
+	bool isLastLine = lineNum == -2
+	    || lineNum - 2 >= textEdit->document()->blockCount();
+	if (isLastLine)
+		curs.movePosition(QTextCursor::End);
+	else {
+		QTextBlock block = textEdit->document()->findBlockByNumber(lineNum - 2);
+		int pos = block.position();
+		if (posInLine < 0)
+			curs.movePosition(QTextCursor::EndOfLine, QTextCursor::MoveAnchor);
+		else
+			curs.setPosition(pos + qMin(posInLine, block.length() - 1),
+			    QTextCursor::MoveAnchor);
+	}
+	textEdit->setTextCursor(curs);
+}
+
 void
 FPsingleton::switchToExistingTab(FPwin* fpw, int idx, int lineNum, int posInLine,
     bool hasCursorInfo)
@@ -277,19 +312,19 @@ FPsingleton::switchToExistingTab(FPwin* fpw, int idx, int lineNum, int posInLine
 	TextEdit *textEdit = thisTabPage->textEdit();
 	fpw->ui->tabWidget->setCurrentIndex(idx);
 	if (hasCursorInfo) {
-		QTextCursor curs = textEdit->textCursor();
-		bool isLastLine = lineNum == -2 || lineNum > textEdit->document()->blockCount();
-		if (isLastLine)
-			curs.movePosition(QTextCursor::End);
-		else {
-			QTextBlock block = textEdit->document()->findBlockByNumber(lineNum - 2);
-			int pos = block.position();
-			if (posInLine < 0)
-				curs.movePosition(QTextCursor::EndOfLine, QTextCursor::MoveAnchor);
-			else
-				curs.setPosition(pos + posInLine, QTextCursor::MoveAnchor);
-		}
-		textEdit->setTextCursor(curs);
+		if (textEdit->isHibernated()) {
+			/*
+			 * The document is empty until its file is reloaded,
+			 * so the cursor is moved after that (only once).
+			 */
+			auto conn = QSharedPointer<QMetaObject::Connection>::create();
+			*conn = connect(textEdit, &TextEdit::wokenUp, textEdit,
+			    [textEdit, lineNum, posInLine, conn] {
+				QObject::disconnect(*conn);
+				moveToLine(textEdit, lineNum, posInLine);
+			});
+		} else
+			moveToLine(textEdit, lineNum, posInLine);
 	}
 	/*
 	 * Because we don't actually open a _new_
@@ -40,6 +40,7 @@ public:
     void firstWin(const QString& message);
     FPwin* newWin (QString pwd, const QStringList &filesList = QStringList());
     void removeWin (FPwin *win);
+    void switchToExistingTab(FPwin* fpw, int idx, int lineNum, int posInLine, bool hasCursorInfo);
 
     QList<FPwin*> Wins; // All fpad windows.
 
@@ -61,7 +62,6 @@ private:
     bool check_file_exists(QString filename);
     QStringList processInfo (const QString& message,
                              long &desktop, bool *newWindow);
-    void switchToExistingTab(FPwin* fpw, int idx, int lineNum, int posInLine, bool hasCursorInfo);
 
     QString uniqueKey_;
     QLockFile *lockFile_;
@@ -37,6 +37,8 @@ TabPage::TabPage(const QList<QKeySequence> &searchShortcuts,
 
     connect (searchBar_, &SearchBar::find, this, &TabPage::find);
     connect (searchBar_, &SearchBar::searchFlagChanged, this, &TabPage::searchFlagChanged);
+    connect (searchBar_, &SearchBar::searchTextEdited, this, &TabPage::searchTextEdited);
+    connect (searchBar_, &SearchBar::incrementalSearch, this, &TabPage::incrementalSearch);
 }
 void TabPage::setSearchBarVisible (bool visible)
 {
@@ -22,48 +22,223 @@
 #include <QPainter>
 #include <QRegularExpression>
 #include <QClipboard>
+#include <QMimeData>
 #include <QTextDocumentFragment>
+#include <QGlyphRun>
+#include <QTextLayout>
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QFileInfo>
+#include <QAbstractTextDocumentLayout>
+#include <QThreadPool>
+#include <QtMath>
+#include <algorithm>
 #include "textedit.h"
+#include "blockdata.h"
+#include "indentation.h"
 #include "vscrollbar.h"
+#include "textfinder.h"
+#include "searchjob.h"
+#include "tracer.h"
+#include "lazymimedata.h"
+#include "docindex.h"
 #include "theme.h"
 
 #define UPDATE_INTERVAL 50
 #define SCROLL_FRAMES_PER_SEC 60
 #define SCROLL_DURATION 300
+#define RULER_W 80 // How much characters does ruler limit.
+#define PREFETCH_BLOCKS 100 // Blocks laid out on each side of a jump target.
+#define PREFETCH_TARGETS 32
+#define PREFETCH_BUDGET 4 // ms per step
+#define PREFETCH_PAUSE 500 // ms after a key press
+#define OVERVIEW_BINS 1024 // The resolution of the scrollbar overview.
+#define OVERVIEW_DELAY 500 // ms after the last change
+#define LAZY_COPY 1048576 // chars; smaller selections are copied at once
+#define FRAGMENT_COPY 65536 // chars; larger selections are copied without a fragment
+#define CHUNKED_PASTE 1048576 // chars; smaller texts are pasted at once
+#define BACKWARD_WINDOW 65536 // chars searched backward before the whole text
+#define PASTE_CHUNK 65536
+#define PASTE_BUDGET 20 // ms per step
+#define HIBERNATE_MIN 65536 // chars; smaller documents aren't worth reloading
+#define BLOCK_MEMORY 160 // bytes; a rough size of a block with its data and layout
 
 namespace fpad {
 
+static const QPalette &editorPalette()
+{
+    static QPalette palette;
+    static bool initialized = false;
+    if (!initialized)
+    {
+        palette = QApplication::palette();
+        palette.setColor (QPalette::Base, QCOLOR(TEXT_BG));
+        palette.setColor (QPalette::Text, Qt::black);
+        palette.setColor (QPalette::Highlight, QCOLOR(TEXT_SELECT_BG));
+        palette.setColor (QPalette::HighlightedText, QCOLOR(TEXT_SELECT_FG));
+        initialized = true;
+    }
+    return palette;
+}
+
+/* The measurements of a font that every editor with it needs. They are
+   cached for the whole process because all tabs usually have the same
+   font. (Only used in the GUI thread.) */
+struct FontInfo
+{
+    int maxWidth;
+    int height;
+    int widestDigit; // in the bold line number font
+    int digitW[10]; // in the line number font
+    /* the glyph cache of the fast path of paintEvent() (zero for
+       characters that need QTextLayout) */
+    QRawFont rawFont;
+    quint32 latin1Glyphs[256];
+    qreal fixedAdvance;
+};
+
+/* Finds the glyphs of the printable Latin-1 characters that have the same
+   advance in the layouts of the document, if the font has a fixed pitch. */
+static void fillGlyphCache (FontInfo &info, const QFont &f)
+{
+    info.fixedAdvance = 0;
+    std::fill (info.latin1Glyphs, info.latin1Glyphs + 256, 0);
+    if (!QFontInfo (f).fixedPitch()) return;
+    info.rawFont = QRawFont::fromFont (f);
+    if (!info.rawFont.isValid()) return;
+
+    QString chars;
+    for (ushort c = 0x20; c <= 0xFF; ++c)
+    {
+        if (c < 0x7F || (c >= 0xA0 && c != 0xAD)) // no control character or soft hyphen
+            chars += QChar (c);
+    }
+    const QVector<quint32> glyphs = info.rawFont.glyphIndexesForString (chars);
+    if (glyphs.size() != chars.size()) return;
+
+    QTextLayout layout (chars, f);
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    layout.endLayout();
+    if (!line.isValid()) return;
+    const qreal advance = line.cursorToX ('M' - 0x20) - line.cursorToX ('L' - 0x20);
+    if (advance <= 0) return;
+    qreal x = line.cursorToX (0);
+    for (int i = 0; i < chars.size(); ++i)
+    {
+        const qreal next = line.cursorToX (i + 1);
+        if (glyphs.at (i) != 0 && qAbs (next - x - advance) < 0.01)
+            info.latin1Glyphs[chars.at (i).unicode()] = glyphs.at (i);
+        x = next;
+    }
+    info.fixedAdvance = advance;
+}
+
+/* The line numbers are never bold. */
+static QFont lineNumberFont (const QFont &f)
+{
+    QFont F (f);
+    F.setBold (false);
+    return F;
+}
+
+static const FontInfo &sharedFontInfo (const QFont &f)
+{
+    static QHash<QString, QSharedPointer<FontInfo> > cache;
+    const QString key = f.key();
+    if (const QSharedPointer<FontInfo> info = cache.value (key))
+        return *info;
+
+    QSharedPointer<FontInfo> info = QSharedPointer<FontInfo>::create();
+    const QFontMetrics metrics (f);
+    info->maxWidth = metrics.maxWidth();
+    info->height = metrics.height();
+    const QFontMetrics digitMetrics (lineNumberFont (f));
+    QFont B (f);
+    B.setBold (true);
+    const QFontMetrics boldMetrics (B);
+    info->widestDigit = 0;
+    int maxW = 0;
+    for (int i = 0; i < 10; ++i)
+    {
+#if (QT_VERSION >= QT_VERSION_CHECK(5,11,0))
+        info->digitW[i] = digitMetrics.horizontalAdvance (QString::number (i));
+        int w = boldMetrics.horizontalAdvance (QString::number (i));
+#else
+        info->digitW[i] = digitMetrics.width (QString::number (i));
+        int w = boldMetrics.width (QString::number (i));
+#endif
+        if (w > maxW)
+        {
+            maxW = w;
+            info->widestDigit = i;
+        }
+    }
+    fillGlyphCache (*info, f);
+    cache.insert (key, info);
+    return *info;
+}
+
+/* Renders the digits of the line numbers side by side into a pixmap, which
+   is used by lineNumberAreaPaintEvent() instead of drawing text. It is
+   shared like FontInfo. */
+static QPixmap digitAtlas (const QFont &f, qreal dpr)
+{
+    static QHash<QString, QPixmap> cache;
+    const QString key = f.key() + QLatin1Char ('@') + QString::number (dpr);
+    QPixmap atlas = cache.value (key);
+    if (!atlas.isNull()) return atlas;
+
+    const FontInfo &info = sharedFontInfo (f);
+    int w = 0;
+    for (int i = 0; i < 10; ++i)
+        w += info.digitW[i];
+    atlas = QPixmap (qCeil (w * dpr), qCeil (info.height * dpr));
+    atlas.setDevicePixelRatio (dpr);
+    atlas.fill (Qt::transparent);
+    QPainter painter (&atlas);
+    painter.setFont (lineNumberFont (f));
+    painter.setPen (Qt::black);
+    int x = 0;
+    for (int i = 0; i < 10; ++i)
+    {
+        painter.drawText (QRect (x, 0, info.digitW[i], info.height),
+                          Qt::AlignRight, QString::number (i));
+        x += info.digitW[i];
+    }
+    painter.end();
+    cache.insert (key, atlas);
+    return atlas;
+}
+
 TextEdit::TextEdit (QWidget *parent) : QPlainTextEdit (parent)
 {
     prevAnchor_ = prevPos_ = -1;
     widestDigit_ = 0;
+    rulerX_ = 0;
     autoIndentation_ = true;
     saveCursor_ = false;
     keepTxtCurHPos_ = false;
     txtCurHPos_ = -1;
+    snapshotValid_ = false;
+    fixedAdvance_ = 0;
+    std::fill (latin1Glyphs_, latin1Glyphs_ + 256, 0);
+    std::fill (digitX_, digitX_ + 10, 0);
+    std::fill (digitW_, digitW_ + 10, 0);
     textTab_ = "    ";
+    pendingWrap_ = -1;
+    pendingTabSize_ = 0;
+    hasPendingFont_ = false;
+    prefetchNext_ = 0;
+    prefetchLast_ = -1;
+    prefetchTimer_ = new QTimer (this);
+    connect (prefetchTimer_, &QTimer::timeout, this, &TextEdit::prefetchLayoutStep);
     setMouseTracking(true);
     setCursorWidth(13);
-    setStyleSheet ("QPlainTextEdit {"
-                           "selection-background-color: " STR(TEXT_SELECT_BG) ";"
-                           "selection-color: " STR(TEXT_SELECT_FG) ";}"
-                           "QScrollBar {"
-                           "	background: " STR(SCROLL_FG) ";}"
-                           "QScrollBar::add-line {"
-                           "	border-color: " STR(SCROLL_FG) ";}"
-                           "QScrollBar::sub-line {"
-                           "	border-color: " STR(SCROLL_FG) ";}"
-                           "QScrollBar::add-page {"
-                           "	background: " STR(SCROLL_BG) ";}"
-                           "QScrollBar::sub-page {"
-                           "	background: " STR(SCROLL_BG) ";}"
-                           "QScrollBar::handle {"
-                           "	min-height: 75px;"
-                           "	border:1px solid " STR(SCROLL_FG) ";}"
-	);
-    viewport()->setStyleSheet(QString(".QWidget {"
-        "color: black;"
-        "background-color: " STR(TEXT_BG) ";}"));
+    /* the colors come from a shared palette and are pinned, with the
+       scrollbars, by the style sheet of the tab widget (-> FPwin::FPwin()),
+       so that no style sheet is parsed for a new tab */
+    setPalette (editorPalette());
     separatorColor_ = Qt::black;
 
     size_ = 0;
@@ -81,11 +256,57 @@ TextEdit::TextEdit (QWidget *parent) : QPlainTextEdit (parent)
     lineNumberArea_->installEventFilter (this);
 
     connect (this, &QPlainTextEdit::updateRequest, this, &TextEdit::onUpdateRequesting);
+    /* without wrapping, a horizontal scroll changes the visible columns */
+    connect (horizontalScrollBar(), &QAbstractSlider::valueChanged, this, &TextEdit::updateRect);
     connect (this, &QPlainTextEdit::cursorPositionChanged, [this] {
         if (!keepTxtCurHPos_)
             txtCurHPos_ = -1;
     });
     connect (this, &QPlainTextEdit::selectionChanged, this, &TextEdit::onSelectionChanged);
+    connect (document(), &QTextDocument::contentsChange, this, [this] {
+        snapshotValid_ = false;
+        snapshot_.clear();
+    });
+    connect (document(), &QTextDocument::contentsChange, this, &TextEdit::updateBlockData);
+
+    multiEditing_ = false;
+    rectSelecting_ = false;
+    rectAnchorBlock_ = rectAnchorColumn_ = 0;
+    connect (document(), &QTextDocument::contentsChange, this, [this] {
+        if (!multiEditing_) // the cursor positions would be invalid
+            clearMultiCursors();
+    });
+
+    initUndoBudget();
+    lineOpId_ = 0;
+    hibernated_ = waking_ = false;
+    hibernatedAnchor_ = hibernatedPos_ = hibernatedScroll_ = 0;
+    idleTimer_.start();
+
+    pastePos_ = 0;
+    pasteLabel_ = nullptr;
+    pasteTimer_ = new QTimer (this);
+    pasteTimer_->setSingleShot (true);
+    connect (pasteTimer_, &QTimer::timeout, this, &TextEdit::pasteStep);
+
+    overviewSearchId_ = 0;
+    overviewSearchNeeded_ = false;
+    overviewChanges_ = 0;
+    overviewCs_ = overviewRegex_ = false;
+    saveGeneration_ = 0;
+    overviewBlocks_ = -1;
+    overviewTimer_ = new QTimer (this);
+    overviewTimer_->setSingleShot (true);
+    overviewTimer_->setInterval (OVERVIEW_DELAY);
+    connect (overviewTimer_, &QTimer::timeout, this, &TextEdit::updateOverview);
+    connect (document(), &QTextDocument::modificationChanged, this, [this] (bool modified) {
+        if (modified) return;
+        /* the file is saved (or the changes are undone): the blocks of
+           the previous generation aren't edited anymore */
+        ++saveGeneration_;
+        editBins_.fill (0);
+        overviewTimer_->start();
+    });
 
     setContextMenuPolicy (Qt::CustomContextMenu);
 }
@@ -102,6 +323,20 @@ bool TextEdit::eventFilter (QObject *watched, QEvent *event)
     return QPlainTextEdit::eventFilter (watched, event);
 }
 
+static void applyTabStop (QTextDocument *doc, const QFont &f, const QString &textTab)
+{
+    QFontMetricsF metrics (f);
+    QTextOption opt = doc->defaultTextOption();
+#if (QT_VERSION >= QT_VERSION_CHECK(5,11,0))
+    opt.setTabStopDistance (metrics.horizontalAdvance (textTab));
+#elif (QT_VERSION >= QT_VERSION_CHECK(5,10,0))
+    opt.setTabStopDistance (metrics.width (textTab));
+#else
+    opt.setTabStop (metrics.width (textTab));
+#endif
+    doc->setDefaultTextOption (opt);
+}
+
 void TextEdit::setEditorFont (const QFont &f, bool setDefault)
 {
     if (setDefault)
@@ -109,43 +344,38 @@ void TextEdit::setEditorFont (const QFont &f, bool setDefault)
     setFont (f);
     viewport()->setFont (f);
     document()->setDefaultFont (f);
-    QFontMetricsF metrics (f);
-    QTextOption opt = document()->defaultTextOption();
-#if (QT_VERSION >= QT_VERSION_CHECK(5,11,0))
-    opt.setTabStopDistance (metrics.horizontalAdvance (textTab_));
-#elif (QT_VERSION >= QT_VERSION_CHECK(5,10,0))
-    opt.setTabStopDistance (metrics.width (textTab_));
-#else
-    opt.setTabStop (metrics.width (textTab_));
-#endif
-    document()->setDefaultTextOption (opt);
-    QFont F(f);
-    if (f.bold())
-    {
-        F.setBold (false);
-        lineNumberArea_->setFont (F);
-    }
-    else
-        lineNumberArea_->setFont (f);
-    F.setBold (true);
-    widestDigit_ = 0;
-    int maxW = 0;
+    applyTabStop (document(), f, textTab_);
+    lineNumberArea_->setFont (lineNumberFont (f));
+
+    const FontInfo &info = sharedFontInfo (f);
+    int x = 0;
     for (int i = 0; i < 10; ++i)
     {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,11,0))
-        int w = QFontMetrics (F).horizontalAdvance (QString::number (i));
-#else
-        int w = QFontMetrics (F).width (QString::number (i));
-#endif
-        if (w > maxW)
-        {
-            maxW = w;
-            widestDigit_ = i;
-        }
+        digitX_[i] = x;
+        digitW_[i] = info.digitW[i];
+        x += digitW_[i];
     }
+    digitAtlas_ = QPixmap(); // made on painting the line numbers
+    rawFont_ = info.rawFont;
+    std::copy (info.latin1Glyphs, info.latin1Glyphs + 256, latin1Glyphs_);
+    fixedAdvance_ = info.fixedAdvance;
+    /*
+     * An x coordinate within the text widget, where the ruler appears.
+     * Add a half of a character width to it in order to make violating
+     * the ruler more clearly visible.
+     */
+    int char_w = info.maxWidth;
+    rulerX_ = (char_w * RULER_W) + (char_w / 2);
+    widestDigit_ = info.widestDigit;
 }
 TextEdit::~TextEdit()
 {
+    releaseUndoBudget();
+    DocIndex::remove (this);
+    if (lineOpCancel_)
+        lineOpCancel_->store (1);
+    if (overviewCancel_)
+        overviewCancel_->store (1);
     delete lineNumberArea_;
 }
 int TextEdit::lineNumberAreaWidth()
@@ -169,10 +399,11 @@ int TextEdit::lineNumberAreaWidth()
 
 void TextEdit::updateLineNumberAreaWidth (int /* newBlockCount */)
 {
-    if (QApplication::layoutDirection() == Qt::RightToLeft)
-        setViewportMargins (0, 0, lineNumberAreaWidth(), 0);
-    else
-        setViewportMargins (lineNumberAreaWidth(), 0, 0, 0);
+    const QMargins margins = QApplication::layoutDirection() == Qt::RightToLeft
+                                 ? QMargins (0, 0, lineNumberAreaWidth(), 0)
+                                 : QMargins (lineNumberAreaWidth(), 0, 0, 0);
+    if (margins != viewportMargins()) // don't relayout for nothing
+        setViewportMargins (margins);
 }
 
 void TextEdit::updateLineNumberArea (const QRect &rect, int dy)
@@ -195,101 +426,107 @@ void TextEdit::updateLineNumberArea (const QRect &rect, int dy)
         lineNumberArea_->update (0, totalRect.y(), lineNumberArea_->width(), totalRect.height());
     }
 
-    if (rect.contains (viewport()->rect()))
+    /* scrolling can't change the width */
+    if (dy == 0 && rect.contains (viewport()->rect()))
         updateLineNumberAreaWidth (0);
 }
+/* QPlainTextEdit repaints the old and new cursor rectangles itself and
+   reports a scroll with its own update request. Here, only the gutter
+   rows of the old and new cursor positions are reported as changed.
+   Without a vertical scroll, updateRect() is emitted explicitly because
+   these requests don't refresh the highlights. */
+void TextEdit::setTextCursor (const QTextCursor &cursor)
+{
+    if (!multiEditing_)
+        clearMultiCursors();
+    const QRect oldRect = cursorRect();
+    const int oldScroll = verticalScrollBar()->value();
+    QPlainTextEdit::setTextCursor (cursor);
+    const QRect newRect = cursorRect();
+    const int w = viewport()->width();
+    emit QPlainTextEdit::updateRequest (QRect (0, oldRect.y(), w, oldRect.height()), 0);
+    if (newRect.y() != oldRect.y())
+        emit QPlainTextEdit::updateRequest (QRect (0, newRect.y(), w, newRect.height()), 0);
+    if (verticalScrollBar()->value() == oldScroll)
+        emit updateRect();
+}
 
+/* The indentation of the cursor line up to the cursor (or to the start
+   of the selection). */
 QString TextEdit::computeIndentation (const QTextCursor &cur) const
 {
-    QTextCursor cusror = cur;
-    if (cusror.hasSelection())
-    {
-        if (cusror.anchor() <= cusror.position())
-            cusror.setPosition (cusror.anchor());
-        else
-            cusror.setPosition (cusror.position());
-    }
-    QTextCursor tmp = cusror;
-    tmp.movePosition (QTextCursor::StartOfBlock);
-    QString str;
-    if (tmp.atBlockEnd())
-        return str;
-    int pos = tmp.position();
-    tmp.setPosition (++pos, QTextCursor::KeepAnchor);
-    QString selected;
-    while (!tmp.atBlockEnd()
-           && tmp <= cusror
-           && ((selected = tmp.selectedText()) == " "
-               || (selected = tmp.selectedText()) == "\t"))
-    {
-        str.append (selected);
-        tmp.setPosition (pos);
-        tmp.setPosition (++pos, QTextCursor::KeepAnchor);
-    }
-    if (tmp.atBlockEnd()
-        && tmp <= cusror
-        && ((selected = tmp.selectedText()) == " "
-            || (selected = tmp.selectedText()) == "\t"))
-    {
-        str.append (selected);
-    }
-    return str;
+    const int pos = qMin (cur.anchor(), cur.position());
+    const QTextBlock block = document()->findBlock (pos);
+    const QString text = block.text();
+    return text.left (qMin (leadingTabsAndSpaces (text), pos - block.position()));
 }
 
 /*
- * It does un-indentation of a current string of selected block.
+ * Indents or unindents the blocks from "first" to "last" by replacing
+ * them in a single edit (one undo step and one relayout). The new
+ * indentations are computed from the tab size, without layout queries.
+ * Unindenting removes one tab stop of columns, or two spaces at most if
+ * "twoSpace" is true. The selection is kept on the same characters.
  */
-QTextCursor TextEdit::backTabCursor (const QTextCursor& cursor, bool twoSpace) const
-{
-    QTextCursor tmp = cursor;
-    tmp.movePosition (QTextCursor::StartOfBlock);
-    const QString blockText = cursor.block().text();
-    int indx = 0;
-    QRegularExpressionMatch match;
-    if (blockText.indexOf (QRegularExpression ("^\\s+"), 0, &match) > -1)
-        indx = match.capturedLength();
-    else
-        return tmp;
-    int txtStart = cursor.block().position() + indx;
+void TextEdit::indentBlocks (const QTextBlock &first, const QTextBlock &last,
+                             bool indent, bool twoSpace)
+{
+    const int tabSize = qMax (textTab_.length(), 1);
+    QTextCursor cursor = textCursor();
+    int anchor = cursor.anchor(), pos = cursor.position();
+    int newAnchor = anchor, newPos = pos;
+    /* maps a position in the block to the new text */
+    auto mapPos = [] (int offset, int oldIndent, int newIndent, int newBlockPos) {
+        return newBlockPos + (offset >= oldIndent ? offset + newIndent - oldIndent
+                                                  : qMin (offset, newIndent));
+    };
 
-    QString txt = blockText.left (indx);
-    QFontMetricsF fm = QFontMetricsF (document()->defaultFont());
-#if (QT_VERSION >= QT_VERSION_CHECK(5,11,0))
-    qreal spaceL = fm.horizontalAdvance (" ");
-#else
-    qreal spaceL = fm.width (" ");
-#endif
-    int n = 0, i = 0;
-    while ((i = txt.indexOf("\t", i)) != -1)
-    {
-        tmp.setPosition (tmp.block().position() + i);
-        qreal x = static_cast<qreal>(cursorRect (tmp).right());
-        tmp.setPosition (tmp.position() + 1);
-        x = static_cast<qreal>(cursorRect (tmp).right()) - x;
-        n += qMax (qRound (qAbs (x) / spaceL) - 1, 0);
-        ++i;
-    }
-    n += txt.count();
-    n = n % textTab_.count();
-    if (n == 0) n = textTab_.count();
-
-    if (twoSpace) n = qMin (n, 2);
-
-    tmp.setPosition (txtStart);
-    QChar ch = blockText.at (indx - 1);
-    if (ch == QChar (QChar::Space))
-        tmp.setPosition (txtStart - n, QTextCursor::KeepAnchor);
-    else
+    QString newText;
+    bool changed = false;
+    const int start = first.position();
+    for (QTextBlock block = first; block.isValid(); block = block.next())
     {
-        qreal x = static_cast<qreal>(cursorRect (tmp).right());
-        tmp.setPosition (txtStart - 1, QTextCursor::KeepAnchor);
-        x -= static_cast<qreal>(cursorRect (tmp).right());
-        n -= qRound (qAbs (x) / spaceL);
-        if (n < 0) n = 0;
-        tmp.setPosition (tmp.position() - n, QTextCursor::KeepAnchor);
+        const QString text = block.text();
+        const int newBlockPos = start + newText.length();
+        const int oldIndent = indentLength (text);
+        int newIndent = oldIndent;
+        if (indent)
+        {
+            newText += text.leftRef (oldIndent);
+            newText += QLatin1Char ('\t');
+            newText += text.midRef (oldIndent);
+            ++newIndent;
+        }
+        else if (oldIndent > 0)
+        {
+            newIndent = oldIndent - unindentLength (text, oldIndent, tabSize, twoSpace);
+            newText += text.leftRef (newIndent);
+            newText += text.midRef (oldIndent);
+        }
+        else
+            newText += text;
+        if (newIndent != oldIndent)
+            changed = true;
+
+        const int blockPos = block.position();
+        if (anchor >= blockPos && anchor < blockPos + block.length())
+            newAnchor = mapPos (anchor - blockPos, oldIndent, newIndent, newBlockPos);
+        if (pos >= blockPos && pos < blockPos + block.length())
+            newPos = mapPos (pos - blockPos, oldIndent, newIndent, newBlockPos);
+
+        if (block == last) break;
+        newText += QLatin1Char ('\n');
     }
+    if (!changed) return;
+
+    QTextCursor edit (document());
+    edit.setPosition (start);
+    edit.setPosition (last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+    edit.insertText (newText);
 
-    return tmp;
+    cursor.setPosition (newAnchor);
+    cursor.setPosition (newPos, QTextCursor::KeepAnchor);
+    setTextCursor (cursor);
 }
 
 void TextEdit::sync_cursor()
@@ -315,9 +552,27 @@ void TextEdit::sync_cursor()
 	setTextCursor( cursor );
 }
 
+/* the time of the last key press in any editor */
+static QElapsedTimer &lastKeyPress()
+{
+    static QElapsedTimer timer;
+    return timer;
+}
+
 void TextEdit::keyPressEvent (QKeyEvent *event)
 {
+    if (isPasting() || hibernated_)
+    { // only Esc is accepted while pasting or waiting for the reloaded text
+        if (event->key() == Qt::Key_Escape)
+            cancelPaste();
+        event->accept();
+        return;
+    }
     keepTxtCurHPos_ = false;
+    lastKeyPress().start();
+    /* typing has priority over prefetching */
+    if (prefetchTimer_->isActive())
+        prefetchTimer_->start (PREFETCH_PAUSE);
     /* workarounds for copy/cut/... -- see TextEdit::copy()/cut()/... */
     if (event == QKeySequence::Copy)
     {
@@ -372,6 +627,19 @@ void TextEdit::keyPressEvent (QKeyEvent *event)
         return;
     }
 
+    if ((event->key() == Qt::Key_Up || event->key() == Qt::Key_Down)
+        && (event->modifiers() & ~Qt::KeypadModifier) == (Qt::AltModifier | Qt::ShiftModifier))
+    { // column selection (arrows are otherwise unused)
+        addCursorRow (event->key() == Qt::Key_Down);
+        event->accept();
+        return;
+    }
+    if (!cursors_.isEmpty() && multiCursorKey (event))
+    {
+        event->accept();
+        return;
+    }
+
     if (event->key() == Qt::Key_Backspace)
     {
         keepTxtCurHPos_ = true;
@@ -678,24 +946,11 @@ void TextEdit::keyPressEvent (QKeyEvent *event)
     else if (event->key() == Qt::Key_Tab)
     {
         QTextCursor cursor = textCursor();
-        int newLines = cursor.selectedText().count (QChar (QChar::ParagraphSeparator));
-        if (newLines > 0)
+        const QTextBlock first = document()->findBlock (cursor.selectionStart());
+        const QTextBlock last = document()->findBlock (cursor.selectionEnd());
+        if (first != last)
         {
-            cursor.beginEditBlock();
-            cursor.setPosition (qMin (cursor.anchor(), cursor.position()));
-            cursor.movePosition (QTextCursor::StartOfBlock);
-            for (int i = 0; i <= newLines; ++i)
-            {
-                int indx = 0;
-                QRegularExpressionMatch match;
-                if (cursor.block().text().indexOf (QRegularExpression ("^\\s+"), 0, &match) > -1)
-                    indx = match.capturedLength();
-                cursor.setPosition (cursor.block().position() + indx);
-                cursor.insertText ("\t");
-                if (!cursor.movePosition (QTextCursor::NextBlock))
-                    break;
-            }
-            cursor.endEditBlock();
+            indentBlocks (first, last, true);
             ensureCursorVisible();
             event->accept();
             return;
@@ -712,25 +967,9 @@ void TextEdit::keyPressEvent (QKeyEvent *event)
     else if (event->key() == Qt::Key_Backtab)
     {
         QTextCursor cursor = textCursor();
-        int newLines = cursor.selectedText().count (QChar (QChar::ParagraphSeparator));
-        cursor.setPosition (qMin (cursor.anchor(), cursor.position()));
-        cursor.beginEditBlock();
-        cursor.movePosition (QTextCursor::StartOfBlock);
-        for (int i = 0; i <= newLines; ++i)
-        {
-            if (cursor.atBlockEnd())
-            {
-                if (!cursor.movePosition (QTextCursor::NextBlock))
-                    break;
-                continue;
-            }
-            cursor = backTabCursor (cursor, event->modifiers() & Qt::MetaModifier
-                                            ? true : false);
-            cursor.removeSelectedText();
-            if (!cursor.movePosition (QTextCursor::NextBlock))
-                break;
-        }
-        cursor.endEditBlock();
+        indentBlocks (document()->findBlock (cursor.selectionStart()),
+                      document()->findBlock (cursor.selectionEnd()),
+                      false, event->modifiers() & Qt::MetaModifier ? true : false);
         ensureCursorVisible();
         event->accept();
         return;
@@ -758,10 +997,7 @@ void TextEdit::keyPressEvent (QKeyEvent *event)
         {
             QTextCursor cur = textCursor();
             int p = cur.positionInBlock();
-            int indx = 0;
-            QRegularExpressionMatch match;
-            if (cur.block().text().indexOf (QRegularExpression ("^\\s+"), 0, &match) > -1)
-                indx = match.capturedLength();
+            const int indx = indentLength (cur.block().text());
             if (p > 0)
             {
                 if (p <= indx) p = 0;
@@ -781,23 +1017,72 @@ void TextEdit::keyPressEvent (QKeyEvent *event)
 }
 void TextEdit::copy()
 {
+    if (!cursors_.isEmpty())
+    {
+        QApplication::clipboard()->setText (multiCursorText());
+        return;
+    }
     QTextCursor cursor = textCursor();
     if (cursor.hasSelection())
-        QApplication::clipboard()->setText (cursor.selection().toPlainText());
+        QApplication::clipboard()->setMimeData (selectionMimeData (cursor));
+}
+/* A huge selection is not converted to text here but is put into the
+   clipboard as a range of the plain text snapshot, which is copied in a
+   worker thread (-> LazyMimeData), but only if the snapshot is cached or
+   is the selection itself. Otherwise, a large selection is copied at
+   once, without making a document fragment, because the snapshot of the
+   whole document would cost more than the selection. */
+QMimeData *TextEdit::selectionMimeData (const QTextCursor &cursor) const
+{
+    const int start = cursor.selectionStart();
+    const int end = cursor.selectionEnd();
+    if (end - start >= LAZY_COPY
+        && (snapshotValid_ || (start == 0 && end == document()->characterCount() - 1)))
+    {
+        return new LazyMimeData (plainTextSnapshot(), start, end);
+    }
+    QMimeData *data = new QMimeData;
+    if (end - start >= FRAGMENT_COPY)
+    { // as in QTextDocument::toPlainText()
+        QString text = cursor.selectedText();
+        text.replace (QChar::ParagraphSeparator, QLatin1Char ('\n'));
+        text.replace (QChar::LineSeparator, QLatin1Char ('\n'));
+        text.replace (QChar::Nbsp, QLatin1Char (' '));
+        data->setText (text);
+    }
+    else
+        data->setText (cursor.selection().toPlainText());
+    return data;
+}
+QMimeData *TextEdit::createMimeDataFromSelection() const
+{
+    return selectionMimeData (textCursor());
 }
 void TextEdit::cut()
 {
+    if (isPasting()) return;
+    if (!cursors_.isEmpty())
+    {
+        QApplication::clipboard()->setText (multiCursorText());
+        multiCursorEdit (QStringList (QString()));
+        return;
+    }
     QTextCursor cursor = textCursor();
     if (cursor.hasSelection())
     {
         keepTxtCurHPos_ = false;
         txtCurHPos_ = -1;
-        QApplication::clipboard()->setText (cursor.selection().toPlainText());
+        QApplication::clipboard()->setMimeData (selectionMimeData (cursor));
         cursor.removeSelectedText();
     }
 }
 void TextEdit::undo()
 {
+    if (isPasting())
+    {
+        cancelPaste();
+        return;
+    }
     setGreenSel (QList<QTextEdit::ExtraSelection>());
     if (getSearchedText().isEmpty())
     {
@@ -809,30 +1094,204 @@ void TextEdit::undo()
     }
     keepTxtCurHPos_ = false;
     txtCurHPos_ = -1;
+    undoing_ = true;
     QPlainTextEdit::undo();
+    undoing_ = false;
 }
 void TextEdit::redo()
 {
+    if (isPasting()) return;
     keepTxtCurHPos_ = false;
     txtCurHPos_ = -1;
+    undoing_ = true;
     QPlainTextEdit::redo();
+    undoing_ = false;
 }
 void TextEdit::paste()
 {
+    if (isPasting()) return;
+    if (!cursors_.isEmpty())
+    { // one line per cursor if the line count matches
+        QStringList lines = QApplication::clipboard()->text().split (QLatin1Char ('\n'));
+        if (lines.size() != cursors_.size())
+            lines = QStringList (lines.join (QLatin1Char ('\n')));
+        multiCursorEdit (lines);
+        return;
+    }
     keepTxtCurHPos_ = false;
     QPlainTextEdit::paste();
 }
 void TextEdit::selectAll()
 {
+    clearMultiCursors();
     keepTxtCurHPos_ = false;
     txtCurHPos_ = -1;
     QPlainTextEdit::selectAll();
 }
 void TextEdit::insertPlainText (const QString &text)
 {
+    if (isPasting()) return;
+    if (!cursors_.isEmpty())
+    { // an empty text deletes like the Delete key
+        multiCursorEdit (QStringList (text), text.isEmpty() ? 1 : 0);
+        return;
+    }
     keepTxtCurHPos_ = false;
     txtCurHPos_ = -1;
-    QPlainTextEdit::insertPlainText (text);
+    if (text.length() >= CHUNKED_PASTE)
+        startPaste (text);
+    else
+        QPlainTextEdit::insertPlainText (text);
+}
+/* Also called on pasting and dropping. */
+void TextEdit::insertFromMimeData (const QMimeData *source)
+{
+    if (isPasting() || hibernated_) return;
+    if (source->hasText() && cursors_.isEmpty())
+    {
+        const QString text = source->text();
+        if (text.length() >= CHUNKED_PASTE)
+        {
+            startPaste (text);
+            return;
+        }
+    }
+    QPlainTextEdit::insertFromMimeData (source);
+}
+void TextEdit::startPaste (const QString &text)
+{
+    pasteText_ = text;
+    pastePos_ = 0;
+    pasteCursor_ = textCursor();
+    if (pasteLabel_ == nullptr)
+    {
+        pasteLabel_ = new QLabel (viewport());
+        pasteLabel_->setAttribute (Qt::WA_TransparentForMouseEvents);
+        pasteLabel_->setStyleSheet ("QLabel {background-color: rgba(0, 0, 0, 180); color: white;"
+                                    "border-radius: 3px; padding: 5px;}");
+    }
+    pasteLabel_->show();
+    /* the chunks are inserted by pasteCursor_ but nothing else may edit the
+       text meanwhile; otherwise, it would join the edit block of the paste */
+    setReadOnly (true);
+    pasteStep();
+}
+void TextEdit::finishPaste()
+{
+    pasteTimer_->stop();
+    pasteText_.clear();
+    pasteLabel_->hide();
+    setReadOnly (false);
+}
+/* Inserts chunks until the time budget is spent and then lets the events
+   be processed. Chunks end at newlines where possible. The first chunk
+   replaces the selection and the next ones join its edit block. */
+void TextEdit::pasteStep()
+{
+    TRACE_SCOPE ("TextEdit::pasteStep");
+    QElapsedTimer timer;
+    timer.start();
+    const int len = pasteText_.length();
+    do
+    {
+        int end = qMin (pastePos_ + PASTE_CHUNK, len);
+        if (end < len)
+        {
+            const int nl = pasteText_.lastIndexOf (QLatin1Char ('\n'), end - 1);
+            if (nl >= pastePos_)
+                end = nl + 1;
+            else if (pasteText_.at (end - 1).isHighSurrogate()
+                     || pasteText_.at (end - 1) == QLatin1Char ('\r'))
+            {
+                --end;
+            }
+        }
+        if (pastePos_ == 0)
+        {
+            pasteCursor_.beginEditBlock();
+            pasteCursor_.removeSelectedText();
+        }
+        else
+            pasteCursor_.joinPreviousEditBlock();
+        pasteCursor_.insertText (pasteText_.mid (pastePos_, end - pastePos_));
+        pasteCursor_.endEditBlock();
+        pastePos_ = end;
+    } while (pastePos_ < len && timer.elapsed() < PASTE_BUDGET);
+
+    if (pastePos_ < len)
+    {
+        pasteLabel_->setText (QString ("Pasting... %1%  (Esc cancels)")
+                              .arg (static_cast<qint64>(pastePos_) * 100 / len));
+        pasteLabel_->adjustSize();
+        pasteLabel_->move (viewport()->width() - pasteLabel_->width() - 10,
+                           viewport()->height() - pasteLabel_->height() - 10);
+        pasteTimer_->start (0);
+        return;
+    }
+    finishPaste();
+    setTextCursor (pasteCursor_);
+    pasteCursor_ = QTextCursor();
+    ensureCursorVisible();
+    setUndoBytes (undoBytes_); // trimming was postponed
+}
+/* Applies a line operation to the selected lines, or to all lines without
+   a selection, in a worker thread (-> LineOpJob). The result replaces the
+   lines as one undo step, unless the text is changed meanwhile. */
+void TextEdit::applyLineOperation (LineOperation op)
+{
+    if (isReadOnly() || isPasting()) return;
+    QTextCursor cursor = textCursor();
+    QTextBlock first, last;
+    if (cursor.hasSelection())
+    {
+        first = document()->findBlock (cursor.selectionStart());
+        last = document()->findBlock (cursor.selectionEnd());
+        if (last != first && cursor.selectionEnd() == last.position())
+            last = last.previous(); // the selection ends at a line start
+    }
+    else
+    {
+        first = document()->firstBlock();
+        last = document()->lastBlock();
+        if (last != first && last.length() == 1)
+            last = last.previous(); // keep the final newline at the end
+    }
+    const int start = first.position();
+    const int end = last.position() + last.length() - 1;
+    QTextCursor range (document());
+    range.setPosition (start);
+    range.setPosition (end, QTextCursor::KeepAnchor);
+
+    if (lineOpCancel_)
+        lineOpCancel_->store (1);
+    lineOpCancel_ = QSharedPointer<QAtomicInt>::create (0);
+    const int id = ++lineOpId_;
+    const int revision = document()->revision();
+    LineOpJob *job = new LineOpJob (id, range.selectedText(), op, lineOpCancel_);
+    connect (job, &LineOpJob::done, this, [this, revision, start, end] (int id, const QString& result) {
+        if (id != lineOpId_ || document()->revision() != revision) return; // stale
+        lineOpCancel_.clear();
+        QTextCursor cur (document());
+        cur.setPosition (start);
+        cur.setPosition (end, QTextCursor::KeepAnchor);
+        setTextCursor (cur);
+        insertPlainText (result); // pasted in chunks if it is large
+    });
+    QThreadPool::globalInstance()->start (job);
+}
+/* The inserted part is undone, which also restores a replaced selection. */
+void TextEdit::cancelPaste()
+{
+    if (!isPasting()) return;
+    finishPaste();
+    pasteCursor_ = QTextCursor();
+    if (pastePos_ > 0)
+    {
+        undoing_ = true;
+        QPlainTextEdit::undo();
+        undoing_ = false;
+    }
+    ensureCursorVisible();
 }
 void TextEdit::keyReleaseEvent (QKeyEvent *event)
 {
@@ -914,8 +1373,86 @@ static void fillBackground (QPainter *p, const QRectF &rect, QBrush brush, const
     p->fillRect (rect, brush);
     p->restore();
 }
+static bool plainPainting = true;
+void TextEdit::setPlainPainting (bool enable)
+{
+    plainPainting = enable;
+}
+/* The fast path of paintEvent() for blocks of cached characters: their glyphs
+   are positioned arithmetically and only the visible columns are drawn.
+   Returns false if the block should be drawn by QTextLayout instead. */
+bool TextEdit::drawPlainBlock (QPainter *painter, const QTextBlock &block,
+                               const QPointF &offset, const QRect &clip) const
+{
+    if (!plainPainting || fixedAdvance_ <= 0) return false;
+    QTextLayout *layout = block.layout();
+    if (!layout->preeditAreaText().isEmpty() || !layout->formats().isEmpty())
+        return false;
+
+    const BlockData *blockData = static_cast<BlockData*>(block.userData());
+    if (blockData && (!blockData->latin1Only || blockData->tabCount > 0))
+        return false;
+
+    const QString text = block.text();
+    const QChar *data = text.constData();
+    for (int i = 0; i < text.length(); ++i)
+    {
+        const ushort c = data[i].unicode();
+        if (c > 0xFF || latin1Glyphs_[c] == 0)
+            return false;
+    }
+    /* the layout should agree with the arithmetic positions */
+    const int lineCount = layout->lineCount();
+    for (int l = 0; l < lineCount; ++l)
+    {
+        QTextLine line = layout->lineAt (l);
+        if (qAbs (line.cursorToX (line.textStart() + line.textLength())
+                  - line.cursorToX (line.textStart())
+                  - line.textLength() * fixedAdvance_) > 0.5)
+        {
+            return false;
+        }
+    }
+
+    /* QTextLayout uses the foreground of the block or the text color */
+    const QPen oldPen = painter->pen();
+    const QBrush fg = block.charFormat().foreground();
+    painter->setPen (fg.style() != Qt::NoBrush ? fg.color() : palette().text().color());
+    const QPointF pos = offset + layout->position();
+    QVector<quint32> glyphs;
+    QVector<QPointF> positions;
+    for (int l = 0; l < lineCount; ++l)
+    {
+        QTextLine line = layout->lineAt (l);
+        const qreal top = pos.y() + line.y();
+        if (top > clip.bottom() || top + line.height() < clip.top())
+            continue;
+        const int start = line.textStart();
+        const qreal x0 = line.cursorToX (start);
+        int first = start + qMax (0, static_cast<int>((clip.left() - pos.x() - x0) / fixedAdvance_));
+        int last = qMin (start + line.textLength(),
+                         start + static_cast<int>((clip.right() - pos.x() - x0) / fixedAdvance_) + 2);
+        glyphs.clear();
+        positions.clear();
+        for (int i = first; i < last; ++i)
+        {
+            if (data[i] == QLatin1Char (' ')) continue;
+            glyphs.append (latin1Glyphs_[data[i].unicode()]);
+            positions.append (QPointF ((i - start) * fixedAdvance_, 0));
+        }
+        if (glyphs.isEmpty()) continue;
+        QGlyphRun run;
+        run.setRawFont (rawFont_);
+        run.setGlyphIndexes (glyphs);
+        run.setPositions (positions);
+        painter->drawGlyphRun (QPointF (pos.x() + x0, top + line.ascent()), run);
+    }
+    painter->setPen (oldPen); // the cursor is drawn with it
+    return true;
+}
 void TextEdit::paintEvent (QPaintEvent *event)
 {
+    TRACE_SCOPE ("TextEdit::paintEvent");
     QPainter painter (viewport());
     Q_ASSERT (qobject_cast<QPlainTextDocumentLayout*>(document()->documentLayout()));
 
@@ -949,7 +1486,8 @@ void TextEdit::paintEvent (QPaintEvent *event)
         if (r.bottom() >= er.top() && r.top() <= er.bottom())
         {
             /* take care of RTL */
-            bool rtl (block.text().isRightToLeft());
+            const BlockData *data = static_cast<BlockData*>(block.userData());
+            bool rtl (data ? data->rtl : block.text().isRightToLeft());
             QTextOption opt = document()->defaultTextOption();
             if (rtl)
             {
@@ -1050,7 +1588,12 @@ void TextEdit::paintEvent (QPaintEvent *event)
                     painter.save();
                     painter.setPen (separatorColor_);
                 }
-                layout->draw (&painter, offset, selections, er);
+                if (!selections.isEmpty() || rtl
+                    || (opt.flags() & QTextOption::ShowLineAndParagraphSeparators)
+                    || !drawPlainBlock (&painter, block, offset, er))
+                {
+                    layout->draw (&painter, offset, selections, er);
+                }
                 if (opt.flags() & QTextOption::ShowLineAndParagraphSeparators)
                     painter.restore();
             }
@@ -1071,27 +1614,17 @@ void TextEdit::paintEvent (QPaintEvent *event)
         if (offset.y() > viewportRect.height())
             break;
         block = block.next();
-        
-        /**
-         * Draw a ruler (a vertical line) that allows to not
-         * exceed the certain number of characters in width.
-         */
-        
-        /* How much characters does ruler limit. */
-        #define RULER_W 80
-        
-        /* Size of a single character of current font. */
-        int char_w = QFontMetrics(font()).maxWidth();
-        /*
-         * An x coordinate within the text widget, where the ruler appears.
-         * Add a half of a character width to it in order to make violating
-         * the ruler more clearly visible.
-         */
-        int ruler_x = (char_w * RULER_W) + (char_w / 2);
-        QLine ruler = QLine(ruler_x, 0, ruler_x, viewport()->height());
-        painter.drawLine(ruler);
-        
     }
+
+    /**
+     * Draw a ruler (a vertical line) that allows to not
+     * exceed the certain number of characters in width.
+     */
+    painter.drawLine (QLine (rulerX_, 0, rulerX_, viewport()->height()));
+
+    if (!cursors_.isEmpty())
+        drawMultiCursors (&painter);
+
     if (backgroundVisible() && !block.isValid() && offset.y() <= er.bottom()
         && (centerOnScroll() || verticalScrollBar()->maximum() == verticalScrollBar()->minimum()))
     {
@@ -1101,25 +1634,36 @@ void TextEdit::paintEvent (QPaintEvent *event)
 
 void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
 {
+    TRACE_SCOPE ("TextEdit::lineNumberAreaPaintEvent");
+    if (digitAtlas_.isNull()
+        || digitAtlas_.devicePixelRatio() != lineNumberArea_->devicePixelRatioF())
+    { // the screen may have changed
+        digitAtlas_ = digitAtlas (font(), lineNumberArea_->devicePixelRatioF());
+    }
     QPainter painter (lineNumberArea_);
     painter.fillRect (event->rect(), QCOLOR(TEXT_BG));
-    painter.setPen (Qt::black);
-    int w = lineNumberArea_->width();
-    int left = 3;
+    const qreal dpr = digitAtlas_.devicePixelRatio();
+    const int w = lineNumberArea_->width();
+    const int h = fontMetrics().height();
     QTextBlock block = firstVisibleBlock();
     int blockNumber = block.blockNumber();
     int top = static_cast<int>(blockBoundingGeometry (block).translated (contentOffset()).top());
     int bottom = top + static_cast<int>(blockBoundingRect (block).height());
-    int h = fontMetrics().height();
-    QFont bf = font();
-    bf.setBold (true);
     while (block.isValid() && top <= event->rect().bottom())
     {
         if (block.isVisible() && bottom >= event->rect().top())
         {
-            QString number = QString::number (blockNumber + 1);
-            painter.drawText (left, top, w - 3, h,
-                              Qt::AlignRight, number);
+            /* blit the digits from right to left */
+            int n = blockNumber + 1;
+            int x = w;
+            do
+            {
+                const int d = n % 10;
+                x -= digitW_[d];
+                painter.drawPixmap (QPointF (x, top), digitAtlas_,
+                                    QRectF (digitX_[d] * dpr, 0, digitW_[d] * dpr, h * dpr));
+                n /= 10;
+            } while (n > 0);
         }
         block = block.next();
         top = bottom;
@@ -1138,6 +1682,429 @@ void TextEdit::onUpdateRequesting (const QRect& /*rect*/, int dy)
     if (dy == 0) return;
     emit updateRect();
 }
+void TextEdit::setTtextTab (int textTabSize)
+{
+    if (textTab_.length() == textTabSize) return;
+    textTab_ = textTab_.leftJustified (textTabSize, ' ', true);
+    applyTabStop (document(), document()->defaultFont(), textTab_);
+    /* the display widths depend on the tab size */
+    if (!document()->isEmpty())
+        updateBlockData (0, 0, document()->characterCount());
+}
+void TextEdit::setLineWrapModeLater (QPlainTextEdit::LineWrapMode mode)
+{
+    if (isVisible())
+    {
+        pendingWrap_ = -1;
+        setLineWrapMode (mode);
+    }
+    else
+        pendingWrap_ = mode == lineWrapMode() ? -1 : mode;
+}
+void TextEdit::setEditorFontLater (const QFont &f)
+{
+    if (isVisible())
+    {
+        hasPendingFont_ = false;
+        setEditorFont (f);
+    }
+    else
+    {
+        pendingFont_ = f;
+        hasPendingFont_ = true;
+    }
+}
+void TextEdit::setTextTabLater (int textTabSize)
+{
+    if (isVisible())
+    {
+        pendingTabSize_ = 0;
+        setTtextTab (textTabSize);
+    }
+    else
+        pendingTabSize_ = textTabSize == textTab_.length() ? 0 : textTabSize;
+}
+bool TextEdit::isTyping()
+{
+    return lastKeyPress().isValid() && lastKeyPress().elapsed() < PREFETCH_PAUSE;
+}
+void TextEdit::applyPendingSettings()
+{
+    /* the tab size comes first because setEditorFont() uses it */
+    if (pendingTabSize_ > 0)
+    {
+        setTtextTab (pendingTabSize_);
+        pendingTabSize_ = 0;
+    }
+    if (hasPendingFont_)
+    {
+        hasPendingFont_ = false;
+        setEditorFont (pendingFont_);
+    }
+    if (pendingWrap_ >= 0)
+    {
+        setLineWrapMode (static_cast<QPlainTextEdit::LineWrapMode>(pendingWrap_));
+        pendingWrap_ = -1;
+        /* the layout is discarded with the wrap mode */
+        prefetchLayout (0);
+        prefetchLayout (document()->blockCount() - 1);
+    }
+}
+void TextEdit::setFileName (const QString &name)
+{
+    fileName_ = name;
+    DocIndex::insert (this, name);
+}
+bool TextEdit::canHibernate() const
+{
+    return !hibernated_ && !fileName_.isEmpty() && !document()->isModified()
+           && !isReadOnly() && !isPasting() && !lineOpCancel_
+           && document()->characterCount() >= HIBERNATE_MIN
+           && QFileInfo (fileName_).isReadable();
+}
+void TextEdit::hibernate()
+{
+    if (!canHibernate()) return;
+    clearMultiCursors();
+    hibernatedAnchor_ = textCursor().anchor();
+    hibernatedPos_ = textCursor().position();
+    hibernatedScroll_ = verticalScrollBar()->value();
+    prefetchTimer_->stop();
+    prefetchTargets_.clear();
+    hibernated_ = true;
+    setPlainText (QString());
+}
+/* A tab of a restored session starts hibernated, with the cursor position
+   of the last session, and is loaded when it is activated. */
+void TextEdit::makePlaceholder (const QString &fileName, int cursorPos)
+{
+    setFileName (fileName);
+    encoding_.clear(); // detected when the file is loaded
+    hibernatedAnchor_ = hibernatedPos_ = qMax (cursorPos, 0);
+    hibernatedScroll_ = -1; // centered on the cursor
+    hibernated_ = true;
+}
+void TextEdit::wakeUp (const QString &text)
+{
+    if (!hibernated_) return;
+    hibernated_ = waking_ = false;
+    setPlainText (text);
+    const int end = document()->characterCount() - 1;
+    QTextCursor cur = textCursor();
+    cur.setPosition (qMin (hibernatedAnchor_, end));
+    cur.setPosition (qMin (hibernatedPos_, end), QTextCursor::KeepAnchor);
+    prefetchLayout (cur.blockNumber());
+    setTextCursor (cur);
+    const int scroll = hibernatedScroll_;
+    const int pos = cur.position();
+    QTimer::singleShot (0, this, [this, scroll, pos] {
+        if (textCursor().position() != pos)
+            return; // the cursor was moved meanwhile (e.g., after wokenUp())
+        if (scroll < 0)
+            centerCursor();
+        else
+            verticalScrollBar()->setValue (scroll);
+    });
+    emit wokenUp();
+}
+qint64 TextEdit::memoryUsage() const
+{
+    if (hibernated_) return 0;
+    return static_cast<qint64>(document()->characterCount()) * 2
+           + static_cast<qint64>(document()->blockCount()) * BLOCK_MEMORY
+           + undoBytes_;
+}
+void TextEdit::prefetchLayout (int blockNumber)
+{
+    if (blockNumber < 0 || prefetchTargets_.size() >= PREFETCH_TARGETS
+        || prefetchTargets_.contains (blockNumber))
+    {
+        return;
+    }
+    prefetchTargets_.append (blockNumber);
+    if (!prefetchTimer_->isActive())
+        prefetchTimer_->start (0);
+}
+/* Lays out blocks for a few milliseconds and returns to the event loop.
+   (QPlainTextDocumentLayout lays out a block when its bounding rectangle
+   is first requested.) */
+void TextEdit::prefetchLayoutStep()
+{
+    TRACE_SCOPE ("TextEdit::prefetchLayoutStep");
+    if (prefetchTimer_->interval() != 0)
+        prefetchTimer_->setInterval (0); // after a pause
+    QAbstractTextDocumentLayout *layout = document()->documentLayout();
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < PREFETCH_BUDGET)
+    {
+        if (prefetchNext_ > prefetchLast_)
+        {
+            if (prefetchTargets_.isEmpty())
+            {
+                prefetchTimer_->stop();
+                return;
+            }
+            const int target = prefetchTargets_.takeFirst();
+            prefetchNext_ = qMax (target - PREFETCH_BLOCKS, 0);
+            prefetchLast_ = qMin (target + PREFETCH_BLOCKS, document()->blockCount() - 1);
+            continue;
+        }
+        QTextBlock block = document()->findBlockByNumber (prefetchNext_);
+        while (block.isValid() && prefetchNext_ <= prefetchLast_
+               && timer.elapsed() < PREFETCH_BUDGET)
+        {
+            layout->blockBoundingRect (block);
+            block = block.next();
+            ++prefetchNext_;
+        }
+        if (!block.isValid())
+            prefetchNext_ = prefetchLast_ + 1;
+    }
+}
+void TextEdit::setOverviewSearch (const QString &pattern, bool caseSensitive, bool isRegex)
+{
+    if (pattern == overviewPattern_ && caseSensitive == overviewCs_ && isRegex == overviewRegex_)
+        return;
+    overviewPattern_ = pattern;
+    overviewCs_ = caseSensitive;
+    overviewRegex_ = isRegex;
+    overviewRegExp_ = QRegularExpression();
+    if (isRegex)
+    {
+        overviewRegExp_.setPattern (pattern);
+        if (!caseSensitive)
+            overviewRegExp_.setPatternOptions (QRegularExpression::CaseInsensitiveOption);
+    }
+    overviewSearchNeeded_ = true;
+    updateOverview();
+}
+/* Whether a block text has a match of the overview search. Only
+   literal strings with newlines aren't searched for in blocks. */
+bool TextEdit::matchesOverview (const QString &text) const
+{
+    if (overviewPattern_.isEmpty())
+        return false;
+    if (overviewRegex_)
+    {
+        if (!overviewRegExp_.isValid())
+            return false;
+        QRegularExpressionMatchIterator it = overviewRegExp_.globalMatch (text);
+        while (it.hasNext())
+        {
+            if (it.next().capturedLength() > 0)
+                return true;
+        }
+        return false;
+    }
+    return text.contains (overviewPattern_, overviewCs_ ? Qt::CaseSensitive : Qt::CaseInsensitive);
+}
+quint8 TextEdit::overviewMarks (const BlockData *data) const
+{
+    quint8 marks = 0;
+    if (data->matched)
+        marks |= VScrollBar::MatchMark;
+    if (data->columns > RULER_W)
+        marks |= VScrollBar::LongLineMark;
+    if (data->editGeneration == saveGeneration_)
+        marks |= VScrollBar::EditMark;
+    return marks;
+}
+/* Adds (n = 1) or removes (n = -1) the marks of a block to (from) the bins. */
+void TextEdit::addOverviewMarks (int blockNumber, quint8 marks, int n)
+{
+    if (marks == 0 || blockNumber >= overviewBlocks_) return;
+    const int bin = static_cast<int>(static_cast<qint64>(blockNumber) * matchBins_.size()
+                                     / overviewBlocks_);
+    if (marks & VScrollBar::MatchMark)
+        matchBins_[bin] += n;
+    if (marks & VScrollBar::LongLineMark)
+        longBins_[bin] += n;
+    if (marks & VScrollBar::EditMark)
+        editBins_[bin] += n;
+}
+/* Counts the marks of all blocks again. Only the block data is read. */
+void TextEdit::countOverviewMarks()
+{
+    overviewBlocks_ = document()->blockCount();
+    const int bins = qMin (OVERVIEW_BINS, overviewBlocks_);
+    matchBins_.fill (0, bins);
+    longBins_.fill (0, bins);
+    editBins_.fill (0, bins);
+    int i = 0;
+    for (QTextBlock block = document()->firstBlock(); block.isValid(); block = block.next(), ++i)
+    {
+        if (BlockData *data = static_cast<BlockData*>(block.userData()))
+        {
+            data->marks = overviewMarks (data);
+            addOverviewMarks (i, data->marks, 1);
+        }
+    }
+}
+/* Sets the match flags of all blocks from the lines found by the last
+   search of the whole text. */
+void TextEdit::applyOverviewMatches()
+{
+    int i = 0, n = 0;
+    for (QTextBlock block = document()->firstBlock(); block.isValid(); block = block.next(), ++i)
+    {
+        while (n < matchLines_.size() && matchLines_.at (n) < i)
+            ++n;
+        if (BlockData *data = static_cast<BlockData*>(block.userData()))
+            data->matched = n < matchLines_.size() && matchLines_.at (n) == i;
+    }
+    matchLines_.clear();
+    overviewBlocks_ = -1; // count again
+}
+/* Shows the marks of the scrollbar overview. The bins are kept up to date
+   by updateBlockData() as long as the number of lines doesn't change;
+   otherwise, they are counted again here. The whole text is searched in
+   a worker thread only when the search changes, the text is replaced or
+   the searched string has newlines. */
+void TextEdit::updateOverview()
+{
+    if (overviewSearchNeeded_)
+    {
+        overviewSearchNeeded_ = false;
+        if (overviewCancel_)
+            overviewCancel_->store (1);
+        overviewCancel_.clear();
+        matchLines_.clear();
+        ++overviewSearchId_;
+        if (overviewPattern_.isEmpty()
+            || (overviewRegex_ && !overviewRegExp_.isValid()))
+        {
+            applyOverviewMatches();
+        }
+        else
+        {
+            overviewCancel_ = QSharedPointer<QAtomicInt>::create (0);
+            const int id = overviewSearchId_;
+            const int changes = overviewChanges_;
+            SearchJob *job = new SearchJob (id, plainTextSnapshot(), overviewPattern_,
+                                            overviewCs_, overviewRegex_, overviewCancel_);
+            connect (job, &SearchJob::found, this, [this] (int id, const QVector<TextMatch>& matches) {
+                if (id != overviewSearchId_) return; // stale
+                for (const auto &m : matches)
+                    matchLines_.append (m.line);
+            });
+            connect (job, &SearchJob::done, this, [this, changes] (int id) {
+                if (id != overviewSearchId_) return;
+                overviewCancel_.clear();
+                if (changes != overviewChanges_)
+                { // the text has changed in the meantime
+                    matchLines_.clear();
+                    overviewSearchNeeded_ = true;
+                    overviewTimer_->start();
+                    return;
+                }
+                applyOverviewMatches();
+                updateOverview();
+            });
+            QThreadPool::globalInstance()->start (job);
+        }
+    }
+
+    VScrollBar *vScrollBar = qobject_cast<VScrollBar*>(verticalScrollBar());
+    if (vScrollBar == nullptr) return;
+    if (overviewBlocks_ != document()->blockCount())
+        countOverviewMarks();
+    const int bins = matchBins_.size();
+    QVector<quint8> marks (bins, 0);
+    for (int i = 0; i < bins; ++i)
+    {
+        if (matchBins_.at (i) > 0)
+            marks[i] |= VScrollBar::MatchMark;
+        if (longBins_.at (i) > 0)
+            marks[i] |= VScrollBar::LongLineMark;
+        if (editBins_.at (i) > 0)
+            marks[i] |= VScrollBar::EditMark;
+    }
+    vScrollBar->setOverview (marks);
+}
+static void fillBlockData (BlockData *data, const QString &text, int tabSize)
+{
+    data->rtl = text.isRightToLeft();
+    data->asciiOnly = data->latin1Only = true;
+    data->tabCount = 0;
+    int columns = 0;
+    const QChar *chars = text.constData();
+    for (int i = 0; i < text.length(); ++i)
+    {
+        const ushort c = chars[i].unicode();
+        if (c == '\t')
+        {
+            ++data->tabCount;
+            columns = (columns / tabSize + 1) * tabSize;
+            continue;
+        }
+        if (c > 0x7F)
+        {
+            data->asciiOnly = false;
+            if (c > 0xFF)
+                data->latin1Only = false;
+        }
+        ++columns;
+    }
+    data->columns = columns;
+}
+/* Also keeps the scrollbar overview up to date: a change inside a line
+   updates the match flag of its block by searching only that block and
+   moves its marks between the bins. */
+void TextEdit::updateBlockData (int position, int charsRemoved, int charsAdded)
+{
+    const int tabSize = qMax (textTab_.length(), 1);
+    /* replacing the whole text (as in loading) isn't an edit */
+    const bool edit = !(position == 0 && charsAdded >= document()->characterCount() - 1);
+    const bool searchBlocks = edit && !(!overviewRegex_ && overviewPattern_.contains ('\n'));
+    ++overviewChanges_;
+    if (!searchBlocks && !overviewPattern_.isEmpty())
+        overviewSearchNeeded_ = true;
+    overviewTimer_->start();
+
+    QTextBlock block = document()->findBlock (position);
+    const QTextBlock last = document()->findBlock (position + charsAdded);
+    /* the bins are kept only if no line is added or removed */
+    const bool inLine = block == last && overviewBlocks_ == document()->blockCount();
+    if (!inLine)
+        overviewBlocks_ = -1;
+    auto updateMarks = [this, edit, searchBlocks, inLine] (const QTextBlock &block, BlockData *data,
+                                                           const QString &text) {
+        quint8 oldMarks = data->marks;
+        if (data->editGeneration != saveGeneration_)
+            oldMarks &= static_cast<quint8>(~VScrollBar::EditMark); // not counted since the last save
+        if (edit)
+            data->editGeneration = saveGeneration_;
+        if (searchBlocks)
+            data->matched = matchesOverview (text);
+        if (inLine)
+        {
+            const quint8 marks = overviewMarks (data);
+            if (marks != oldMarks)
+            {
+                const int n = block.blockNumber();
+                addOverviewMarks (n, oldMarks, -1);
+                addOverviewMarks (n, marks, 1);
+                data->marks = marks;
+            }
+        }
+    };
+
+    while (block.isValid())
+    {
+        BlockData *data = static_cast<BlockData*>(block.userData());
+        if (data == nullptr)
+        {
+            data = new BlockData;
+            block.setUserData (data);
+        }
+        const QString text = block.text();
+        fillBlockData (data, text, tabSize);
+        updateMarks (block, data, text);
+        if (block == last) break;
+        block = block.next();
+    }
+}
 void TextEdit::onSelectionChanged()
 {
     QTextCursor cur = textCursor();
@@ -1153,12 +2120,18 @@ void TextEdit::onSelectionChanged()
 }
 void TextEdit::showEvent (QShowEvent *event)
 {
+    applyPendingSettings();
     QPlainTextEdit::showEvent (event);
     emit updateRect();
 }
 
 void TextEdit::mouseMoveEvent (QMouseEvent *event)
 {
+    if (rectSelecting_ && (event->buttons() & Qt::LeftButton))
+    {
+        setRectangle (rectAnchorBlock_, rectAnchorColumn_, event->pos());
+        return;
+    }
 	if (event->buttons() == Qt::LeftButton
 	    && (event->globalPos() - selectionPressPoint_).manhattanLength() <=
 	    qApp->startDragDistance())
@@ -1172,6 +2145,17 @@ void TextEdit::mousePressEvent (QMouseEvent *event)
 {
     keepTxtCurHPos_ = false;
     txtCurHPos_ = -1;
+    if (event->button() == Qt::LeftButton && event->modifiers() == Qt::AltModifier)
+    { // a rectangular selection
+        const QTextCursor cur = cursorForPosition (event->pos());
+        rectAnchorBlock_ = cur.blockNumber();
+        rectAnchorColumn_ = cur.positionInBlock();
+        rectSelecting_ = true;
+        setRectangle (rectAnchorBlock_, rectAnchorColumn_, event->pos());
+        event->accept();
+        return;
+    }
+    clearMultiCursors();
     if (event->buttons() == Qt::LeftButton
         && qApp->keyboardModifiers() == Qt::NoModifier)
     {
@@ -1196,13 +2180,19 @@ void TextEdit::mousePressEvent (QMouseEvent *event)
 
 void TextEdit::mouseReleaseEvent (QMouseEvent *event)
 {
+    if (rectSelecting_)
+    {
+        rectSelecting_ = false;
+        event->accept();
+        return;
+    }
     QPlainTextEdit::mouseReleaseEvent (event);
     QTextCursor cursor = textCursor();
     if (cursor.hasSelection())
     {
         QClipboard *cl = QApplication::clipboard();
         if (cl->supportsSelection())
-            cl->setText (cursor.selection().toPlainText(), QClipboard::Selection);
+            cl->setMimeData (selectionMimeData (cursor), QClipboard::Selection);
     }
 
     return;
@@ -1222,54 +2212,58 @@ bool TextEdit::event (QEvent *event)
     }
     return QPlainTextEdit::event (event);
 }
-static bool findBackwardInBlock (const QTextBlock &block, const QString &str, int offset,
-                                 QTextCursor &cursor, QTextDocument::FindFlags flags)
+QList<QPair<int, int> > TextEdit::visibleRanges (int margin) const
 {
-    Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
-                             ? Qt::CaseInsensitive : Qt::CaseSensitive;
-    QString text = block.text();
-    text.replace (QChar::Nbsp, QLatin1Char (' '));
-    if (offset > 0 && offset == text.length())
-        -- offset;
-    int idx = -1;
-    while (offset >= 0 && offset <= text.length())
-    {
-        idx = text.lastIndexOf (str, offset, cs);
-        if (idx == -1)
-            return false;
-        cursor.setPosition (block.position() + idx);
-        cursor.setPosition (cursor.position() + str.length(), QTextCursor::KeepAnchor);
-        return true;
-    }
-    return false;
-}
-
-static bool findBackward (const QTextDocument *txtdoc, const QString &str,
-                          QTextCursor &cursor, QTextDocument::FindFlags flags)
-{
-    if (!str.isEmpty() && !cursor.isNull())
+    QList<QPair<int, int> > ranges;
+    const int h = viewport()->height();
+    QPointF offset (contentOffset());
+    /* the visible horizontal interval in layout coordinates */
+    const qreal left = -offset.x();
+    const qreal right = left + viewport()->width();
+    const bool clip (lineWrapMode() == QPlainTextEdit::NoWrap);
+    QTextBlock block = firstVisibleBlock();
+    while (block.isValid())
     {
-        int pos = cursor.anchor()
-                  - str.size();
-        if (pos >= 0)
+        QRectF r = blockBoundingRect (block).translated (offset);
+        if (r.top() > h) break;
+        if (block.isVisible())
         {
-            QTextBlock block = txtdoc->findBlock (pos);
-            int blockOffset = pos - block.position();
-            while (block.isValid())
+            QTextLayout *layout = block.layout();
+            const int blpos = block.position();
+            const int textLength = block.length() - 1;
+            const int firstRange = ranges.size();
+            for (int i = 0; i < layout->lineCount(); ++i)
             {
-                if (findBackwardInBlock (block, str, blockOffset, cursor, flags))
-                    return true;
-                block = block.previous();
-                blockOffset = block.length() - 1; // newline is included in QTextBlock::length()
+                QTextLine line = layout->lineAt (i);
+                const qreal top = r.top() + line.y();
+                if (top + line.height() < 0) continue;
+                if (top > h) break;
+                int from = line.textStart();
+                int to = from + line.textLength();
+                if (clip)
+                { // RTL text is taken into account by using both ends
+                    int a = line.xToCursor (left);
+                    int b = line.xToCursor (right);
+                    from = qMax (from, qMin (a, b));
+                    to = qMin (to, qMax (a, b) + 1);
+                }
+                from = blpos + qMax (0, from - margin);
+                to = blpos + qMin (textLength, to + margin);
+                if (ranges.size() > firstRange && ranges.last().second >= from)
+                    ranges.last().second = qMax (ranges.last().second, to);
+                else
+                    ranges.append (qMakePair (from, to));
             }
         }
+        offset.ry() += r.height();
+        block = block.next();
     }
-    cursor = QTextCursor();
-    return false;
+    return ranges;
 }
 QTextCursor TextEdit::finding (const QString& str, const QTextCursor& start, QTextDocument::FindFlags flags,
                                bool isRegex, const int end) const
 {
+    TRACE_SCOPE ("TextEdit::finding");
     if (str.isEmpty())
         return QTextCursor();
 
@@ -1344,6 +2338,46 @@ QTextCursor TextEdit::finding (const QString& str, const QTextCursor& start, QTe
         }
         return QTextCursor();
     }
+    else if (flags & QTextDocument::FindBackward)
+    {
+        /* Search the flat text of the document, where blocks are separated
+           by '\n', so that multi-line strings are found like others. The match
+           should end before the anchor, as with forward searches. Unless the
+           snapshot is still valid, the blocks before the anchor are searched
+           first, so that the whole document isn't copied after each edit
+           (as with backward replacements) when the match is near. */
+        TextFinder finder (str, flags & QTextDocument::FindCaseSensitively, false);
+        const int anchor = start.anchor();
+        int len = 0;
+        int indx = -1;
+        if (!snapshotValid_)
+        {
+            QTextBlock block = document()->findBlock (anchor);
+            QStringList lines (block.text().left (anchor - block.position()));
+            int windowStart = block.position();
+            int size = lines.first().length();
+            while (size < BACKWARD_WINDOW && (block = block.previous()).isValid())
+            {
+                lines.append (block.text());
+                windowStart = block.position();
+                size += block.length();
+            }
+            std::reverse (lines.begin(), lines.end());
+            QString window = lines.join (QLatin1Char ('\n'));
+            window.replace (QChar::Nbsp, QLatin1Char (' ')); // as in toPlainText()
+            indx = finder.lastIndexIn (window, window.length() - str.length(), &len);
+            if (indx > -1)
+                indx += windowStart;
+            else if (windowStart == 0)
+                return QTextCursor();
+        }
+        if (indx == -1)
+            indx = finder.lastIndexIn (plainTextSnapshot(), anchor - str.length(), &len);
+        if (indx == -1)
+            return QTextCursor();
+        res.setPosition (indx);
+        res.setPosition (indx + len, QTextCursor::KeepAnchor);
+    }
     else if (str.contains ('\n'))
     {
         QTextCursor cursor = start;
@@ -1353,166 +2387,85 @@ QTextCursor TextEdit::finding (const QString& str, const QTextCursor& start, QTe
         Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
                                  ? Qt::CaseInsensitive : Qt::CaseSensitive;
         QString subStr;
-        if (!(flags & QTextDocument::FindBackward))
+        while (i < sl.count())
         {
-            while (i < sl.count())
+            if (i == 0)
             {
-                if (i == 0)
+                subStr = sl.at (0);
+                if (subStr.isEmpty())
+                {
+                    cursor.movePosition (QTextCursor::EndOfBlock);
+                    if (end > 0 && cursor.anchor() > end)
+                        return QTextCursor();
+                    res.setPosition (cursor.position());
+                    if (!cursor.movePosition (QTextCursor::NextBlock))
+                        return QTextCursor();
+                    ++i;
+                }
+                else
                 {
-                    subStr = sl.at (0);
-                    if (subStr.isEmpty())
+                    if ((found = document()->find (subStr, cursor, flags)).isNull())
+                        return QTextCursor();
+                    if (end > 0 && found.anchor() > end)
+                        return QTextCursor();
+                    cursor.setPosition (found.position());
+                    while (!cursor.atBlockEnd())
                     {
                         cursor.movePosition (QTextCursor::EndOfBlock);
-                        if (end > 0 && cursor.anchor() > end)
-                            return QTextCursor();
-                        res.setPosition (cursor.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        ++i;
-                    }
-                    else
-                    {
+                        cursor.setPosition (cursor.position() - subStr.length());
                         if ((found = document()->find (subStr, cursor, flags)).isNull())
                             return QTextCursor();
                         if (end > 0 && found.anchor() > end)
                             return QTextCursor();
                         cursor.setPosition (found.position());
-                        while (!cursor.atBlockEnd())
-                        {
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            cursor.setPosition (cursor.position() - subStr.length());
-                            if ((found = document()->find (subStr, cursor, flags)).isNull())
-                                return QTextCursor();
-                            if (end > 0 && found.anchor() > end)
-                                return QTextCursor();
-                            cursor.setPosition (found.position());
-                        }
-
-                        res.setPosition (found.anchor());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        ++i;
-                    }
-                }
-                else if (i != sl.count() - 1)
-                {
-                    if (QString::compare (cursor.block().text(), sl.at (i), cs) != 0)
-                    {
-                        cursor.setPosition (res.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        i = 0;
-                        continue;
                     }
 
+                    res.setPosition (found.anchor());
                     if (!cursor.movePosition (QTextCursor::NextBlock))
                         return QTextCursor();
                     ++i;
                 }
-                else
-                {
-                    subStr = sl.at (i);
-                    if (subStr.isEmpty())
-                    	break;
-                    if ((found = document()->find(subStr, cursor, flags)).isNull()
-                        || found.anchor() != cursor.position())
-                    {
-                        cursor.setPosition (res.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                        return QTextCursor();
-                        i = 0;
-                        continue;
-                    }
-                cursor.setPosition (found.position());
-                break;
-                }
             }
-            res.setPosition (cursor.position(), QTextCursor::KeepAnchor);
-        }
-        else
-        {
-            cursor.setPosition (cursor.anchor());
-            int endPos = cursor.position();
-            while (i < sl.count())
+            else if (i != sl.count() - 1)
             {
-                if (i == 0)
+                if (QString::compare (cursor.block().text(), sl.at (i), cs) != 0)
                 {
-                    subStr = sl.at (sl.count() - 1);
-                    if (subStr.isEmpty())
-                    {
-                        cursor.movePosition (QTextCursor::StartOfBlock);
-                        endPos = cursor.position();
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        ++i;
-                    }
-                    else
-                    {
-                        if (!findBackward (document(), subStr, cursor, flags))
-                            return QTextCursor();
-                        while (cursor.anchor() > cursor.block().position())
-                        {
-                            cursor.setPosition (cursor.block().position() + subStr.count());
-                            if (!findBackward (document(), subStr, cursor, flags))
-                                return QTextCursor();
-                        }
-
-                        endPos = cursor.position();
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        ++i;
-                    }
-                }
-                else if (i != sl.count() - 1) // the middle strings
-                {
-                    if (QString::compare (cursor.block().text(), sl.at (sl.count() - i - 1), cs) != 0)
-                    {
-                        cursor.setPosition (endPos);
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        i = 0;
-                        continue;
-                    }
-
-                    if (!cursor.movePosition (QTextCursor::PreviousBlock))
+                    cursor.setPosition (res.position());
+                    if (!cursor.movePosition (QTextCursor::NextBlock))
                         return QTextCursor();
-                    cursor.movePosition (QTextCursor::EndOfBlock);
-                    ++i;
+                    i = 0;
+                    continue;
                 }
-                else
+
+                if (!cursor.movePosition (QTextCursor::NextBlock))
+                    return QTextCursor();
+                ++i;
+            }
+            else
+            {
+                subStr = sl.at (i);
+                if (subStr.isEmpty())
+                	break;
+                if ((found = document()->find(subStr, cursor, flags)).isNull()
+                    || found.anchor() != cursor.position())
                 {
-                    subStr = sl.at (0);
-                    if (subStr.isEmpty())
-                    	break;
-                    if (!cursor.block().text().endsWith (subStr, cs)) {
-                        cursor.setPosition (endPos);
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                        	return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        i = 0;
-                        continue;
-                    }
-                    cursor.setPosition (cursor.anchor() - subStr.count());
-                    break;
+                    cursor.setPosition (res.position());
+                    if (!cursor.movePosition (QTextCursor::NextBlock))
+                    return QTextCursor();
+                    i = 0;
+                    continue;
                 }
+            cursor.setPosition (found.position());
+            break;
             }
-            res.setPosition (cursor.anchor());
-            res.setPosition (endPos, QTextCursor::KeepAnchor);
         }
+        res.setPosition (cursor.position(), QTextCursor::KeepAnchor);
     }
     else
     {
-        if (!(flags & QTextDocument::FindBackward))
-        {
-            res = document()->find (str, start, flags);
-            if (end > 0 && res.anchor() > end)
-                return QTextCursor();
-        }
-        else
-            findBackward (document(), str, res, flags);
+        res = document()->find (str, start, flags);
+        if (end > 0 && res.anchor() > end)
+            return QTextCursor();
     }
 
     return res;
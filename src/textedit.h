@@ -22,8 +22,19 @@
 
 #include <QPlainTextEdit>
 #include <QDateTime>
+#include <QRawFont>
+#include <QPixmap>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QLabel>
+#include <QRegularExpression>
+#include "lineops.h"
 
 namespace fpad {
+class BlockData;
+
 class TextEdit : public QPlainTextEdit
 {
     Q_OBJECT
@@ -32,11 +43,7 @@ public:
     TextEdit (QWidget *parent = nullptr);
     ~TextEdit();
 
-    void setTextCursor (const QTextCursor &cursor)
-    {
-        QPlainTextEdit::setTextCursor (cursor);
-        emit QPlainTextEdit::updateRequest (rect(), 1);
-    }
+    void setTextCursor (const QTextCursor &cursor);
     void sync_cursor();
     void setEditorFont (const QFont &f, bool setDefault = true);
     void adjustScrollbars();
@@ -49,10 +56,85 @@ public:
     QString getTextTab_() const {
         return textTab_;
     }
-    void setTtextTab (int textTabSize) {
-        textTab_ = textTab_.leftJustified (textTabSize, ' ', true);
+    void setTtextTab (int textTabSize);
+
+    /* Multiple cursors, made by a rectangular selection (Alt+drag) or
+       by Alt+Shift+Up/Down (-> multicursor.cc). */
+    bool hasMultiCursors() const {
+        return !cursors_.isEmpty();
+    }
+    void clearMultiCursors();
+
+    /* A large text is pasted in time-sliced chunks, as a single undo step.
+       Esc cancels it. The editor is read-only meanwhile and the document
+       should not be saved or reloaded. */
+    bool isPasting() const {
+        return !pasteText_.isEmpty();
+    }
+    void cancelPaste();
+
+    /* An estimate of the memory taken by the undo/redo history, which is
+       cleared after it exceeds a budget (-> undobudget.cc). */
+    qint64 undoMemory() const {
+        return undoBytes_;
+    }
+    static void setUndoBudgets (qint64 perEditor, qint64 total);
+
+    void applyLineOperation (LineOperation op);
+
+    /* Hibernation drops the document of an unmodified background tab, with
+       its undo history. Only the file data, the cursor and the scroll
+       position remain until the file is reloaded by wakeUp(), which emits
+       wokenUp(). Until then, the empty document shouldn't be saved or
+       navigated. */
+    bool isHibernated() const {
+        return hibernated_;
+    }
+    bool canHibernate() const;
+    void hibernate();
+    void wakeUp (const QString &text);
+    void makePlaceholder (const QString &fileName, int cursorPos);
+    /* The cursor position, also if the document is hibernated. */
+    int cursorPosition() const {
+        return hibernated_ ? hibernatedPos_ : textCursor().position();
+    }
+    bool isWaking() const {
+        return waking_;
+    }
+    void setWaking (bool waking) {
+        waking_ = waking;
+    }
+    /* An estimate of the memory taken by the document and its history. */
+    qint64 memoryUsage() const;
+    /* The time since the tab was last seen as the current one. */
+    void touch() {
+        idleTimer_.start();
+    }
+    qint64 idleTime() const {
+        return idleTimer_.elapsed();
     }
 
+    /* These apply the settings only when the editor is shown, so that
+       changing them doesn't relayout the documents of hidden tabs. */
+    void setLineWrapModeLater (QPlainTextEdit::LineWrapMode mode);
+    void setEditorFontLater (const QFont &f);
+    void setTextTabLater (int textTabSize);
+    bool hasPendingSettings() const {
+        return pendingWrap_ >= 0 || pendingTabSize_ > 0 || hasPendingFont_;
+    }
+    void applyPendingSettings();
+    /* Whether a key was pressed in an editor very recently. */
+    static bool isTyping();
+    /* Enables the fast path of painting (for benchmarking). */
+    static void setPlainPainting (bool enable);
+
+    /* Lays out the blocks around a likely jump target in small steps
+       when idle, so that jumping there doesn't stall the first paint. */
+    void prefetchLayout (int blockNumber);
+
+    /* The search whose matches are shown in the scrollbar overview. */
+    void setOverviewSearch (const QString &pattern, bool caseSensitive, bool isRegex);
+
     QTextEdit::ExtraSelection currentLineSelection() {
         return currentLine_;
     }
@@ -75,6 +157,24 @@ public:
     void setLastModified (const QDateTime& m) {
         lastModified_ = m;
     }
+    /* The plain text of the document, cached until the next change.
+       Positions in it are the same as in the document. */
+    QString plainTextSnapshot() const {
+        if (!snapshotValid_)
+        {
+            snapshot_ = document()->toPlainText();
+            snapshotValid_ = true;
+        }
+        return snapshot_;
+    }
+    /* The same, but the cached snapshot is released, so that it isn't
+       kept for a tab only because a worker thread has searched it. */
+    QString takePlainTextSnapshot() const {
+        const QString snapshot = plainTextSnapshot();
+        snapshot_.clear();
+        snapshotValid_ = false;
+        return snapshot;
+    }
     QString getSearchedText() const {
         return searchedText_;
     }
@@ -90,9 +190,7 @@ public:
     QString getFileName() const {
         return fileName_;
     }
-    void setFileName (const QString &name) {
-        fileName_ = name;
-    }
+    void setFileName (const QString &name); // also indexes the file (-> DocIndex)
 
     QString getEncoding() const {
         return encoding_;
@@ -134,10 +232,17 @@ public:
         keepTxtCurHPos_ = false;
         txtCurHPos_ = -1;
     }
+    /* The document ranges [first, second) of the visible text lines, clipped to
+       the visible columns if lines aren't wrapped and extended by "margin"
+       characters inside their blocks. The cost depends only on what is shown. */
+    QList<QPair<int, int> > visibleRanges (int margin = 0) const;
 
 signals:
     void resized();
     void updateRect();
+    void undoMemoryChanged (qint64 bytes);
+    void undoHistoryCleared();
+    void wokenUp();
 
 public slots:
     void copy();
@@ -164,34 +269,132 @@ protected:
     void mouseDoubleClickEvent (QMouseEvent *event);
     bool event (QEvent *event);
     bool eventFilter (QObject *watched, QEvent *event);
+    QMimeData *createMimeDataFromSelection() const; // for dragging
+    void insertFromMimeData (const QMimeData *source);
 
 private slots:
     void updateLineNumberAreaWidth (int newBlockCount);
     void updateLineNumberArea (const QRect &rect, int dy);
     void onUpdateRequesting (const QRect&, int dy);
     void onSelectionChanged();
+    void updateBlockData (int position, int charsRemoved, int charsAdded);
+    void prefetchLayoutStep();
+    void updateOverview();
+    void pasteStep();
+    void trimUndo();
 
 private:
+    bool drawPlainBlock (QPainter *painter, const QTextBlock &block,
+                         const QPointF &offset, const QRect &clip) const;
     QString computeIndentation (const QTextCursor &cur) const;
-    QTextCursor backTabCursor(const QTextCursor& cursor, bool twoSpace) const;
+    QMimeData *selectionMimeData (const QTextCursor &cursor) const;
+    void startPaste (const QString &text);
+    void finishPaste();
+    void initUndoBudget();
+    void releaseUndoBudget();
+    void setUndoBytes (qint64 bytes);
+    void clearUndoHistory();
+    void indentBlocks (const QTextBlock &first, const QTextBlock &last,
+                       bool indent, bool twoSpace = false);
+    /* multi-cursor editing */
+    struct MultiCursor {
+        int anchor;
+        int position;
+    };
+    void setMultiCursors (QVector<MultiCursor> cursors);
+    bool multiCursorKey (QKeyEvent *event);
+    void multiCursorEdit (const QStringList &texts, int deletion = 0);
+    void moveMultiCursors (int step, bool keepAnchor);
+    void addCursorRow (bool down);
+    void setRectangle (int anchorBlock, int anchorColumn, const QPoint &pos);
+    QString multiCursorText() const;
+    void updateCursorRows (const QVector<MultiCursor> &cursors);
+    void drawMultiCursors (QPainter *painter);
+    /* the scrollbar overview */
+    bool matchesOverview (const QString &text) const;
+    quint8 overviewMarks (const BlockData *data) const;
+    void addOverviewMarks (int blockNumber, quint8 marks, int n);
+    void countOverviewMarks();
+    void applyOverviewMatches();
 
     int prevAnchor_, prevPos_;
     QWidget *lineNumberArea_;
     QTextEdit::ExtraSelection currentLine_;
     QRect lastCurrentLine_;
+    int rulerX_;
     int widestDigit_;
+    /* the pre-rendered digits of the line numbers */
+    QPixmap digitAtlas_;
+    int digitX_[10];
+    int digitW_[10];
     bool autoIndentation_;
     QColor separatorColor_;
     QColor lineHColor_;
     QPoint pressPoint_;
     QPoint selectionPressPoint_;
     QFont font_;
+    /* the glyph cache of the fast path of paintEvent() (zero for
+       characters that need QTextLayout) */
+    QRawFont rawFont_;
+    quint32 latin1Glyphs_[256];
+    qreal fixedAdvance_;
     QString textTab_;
+    /* the settings to apply on showing (-> applyPendingSettings()) */
+    int pendingWrap_; // -1 if unchanged
+    int pendingTabSize_; // 0 if unchanged
+    bool hasPendingFont_;
+    QFont pendingFont_;
+    /* layout prefetching (-> prefetchLayoutStep()) */
+    QTimer *prefetchTimer_;
+    QList<int> prefetchTargets_;
+    int prefetchNext_, prefetchLast_; // the block range in progress
+    /* the scrollbar overview (-> updateOverview()) */
+    QTimer *overviewTimer_;
+    QString overviewPattern_;
+    bool overviewCs_, overviewRegex_;
+    QRegularExpression overviewRegExp_;
+    QSharedPointer<QAtomicInt> overviewCancel_;
+    int overviewSearchId_;
+    bool overviewSearchNeeded_; // the whole text should be searched again
+    int overviewChanges_; // counts the changes, to know stale search results
+    QVector<int> matchLines_;
+    int saveGeneration_; // blocks changed since the last save have it
+    /* the marks of the blocks counted per bin, for "overviewBlocks_" blocks
+       (-1 if they should be counted again after lines are added or removed) */
+    int overviewBlocks_;
+    QVector<int> matchBins_, longBins_, editBins_;
+    /* the cursors of the multi-cursor mode in the ascending order, each
+       inside a block; the last one is also the text cursor */
+    QVector<MultiCursor> cursors_;
+    bool multiEditing_;
+    bool rectSelecting_; // by Alt+drag
+    int rectAnchorBlock_, rectAnchorColumn_;
+    /* the chunked paste (-> pasteStep()) */
+    QTimer *pasteTimer_;
+    QString pasteText_;
+    int pastePos_; // in pasteText_
+    QTextCursor pasteCursor_;
+    QLabel *pasteLabel_;
+    /* the undo budget */
+    qint64 undoBytes_, undoReported_;
+    qint64 settledBytes_; // the history size after the last finished edit
+    qint64 largestStep_; // the largest finished edit since the history was cleared
+    bool undoing_; // while undoing or redoing
+    bool trimPending_;
+    /* the line operation in progress (-> applyLineOperation()) */
+    QSharedPointer<QAtomicInt> lineOpCancel_;
+    int lineOpId_;
+    /* hibernation */
+    bool hibernated_, waking_;
+    int hibernatedAnchor_, hibernatedPos_, hibernatedScroll_;
+    QElapsedTimer idleTimer_;
     bool keepTxtCurHPos_;
     int txtCurHPos_;
     qint64 size_;
     QDateTime lastModified_;
     QString searchedText_;
+    mutable QString snapshot_;
+    mutable bool snapshotValid_;
     QString replaceTitle_;
     QString fileName_;
     QString encoding_;
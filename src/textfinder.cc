@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include "textfinder.h"
+
+#define MAX_CONTEXT 200
+#define CHUNK_SIZE (1024*1024) // the cancellation granularity of literal searches
+
+namespace fpad {
+
+static inline QChar foldCase (QChar c, bool caseSensitive)
+{
+    return caseSensitive ? c : c.toCaseFolded();
+}
+
+TextFinder::TextFinder (const QString& pattern, bool caseSensitive, bool isRegex) :
+    pattern_ (pattern),
+    caseSensitive_ (caseSensitive),
+    isRegex_ (isRegex)
+{
+    for (int i = 0; i < 256; ++i)
+        backwardSkip_[i] = qMax (pattern_.length(), 1);
+    if (isRegex_)
+    {
+        regex_.setPattern (pattern_);
+        regex_.setPatternOptions (caseSensitive
+                                      ? QRegularExpression::MultilineOption
+                                      : QRegularExpression::MultilineOption
+                                        | QRegularExpression::CaseInsensitiveOption);
+    }
+    else
+    {
+        matcher_.setPattern (pattern_);
+        matcher_.setCaseSensitivity (caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+
+        /* the mirror of the Horspool table: the distance of the first occurrence
+           of a character (after the first one) from the start of the pattern */
+        const int plen = pattern_.length();
+        foldedPattern_.resize (plen);
+        for (int i = 0; i < plen; ++i)
+            foldedPattern_[i] = foldCase (pattern_.at (i), caseSensitive_);
+        for (int i = plen - 1; i > 0; --i)
+            backwardSkip_[foldedPattern_.at (i).unicode() & 0xff] = i;
+    }
+}
+
+bool TextFinder::isValid() const
+{
+    if (pattern_.isEmpty())
+        return false;
+    return (!isRegex_ || regex_.isValid());
+}
+
+int TextFinder::indexIn (const QString& text, int from, int *length,
+                         const QAtomicInt *cancel) const
+{
+    if (from < 0) from = 0;
+    if (from > text.length()) return -1;
+    if (!isRegex_)
+    {
+        const int size = text.length();
+        const int plen = pattern_.length();
+        while (from <= size - plen)
+        {
+            if (cancel && cancel->load() != 0)
+                return -1;
+            /* a chunk covers the matches that start in [from, from + CHUNK_SIZE) */
+            int end = size - from - plen < CHUNK_SIZE ? size : from + CHUNK_SIZE + plen - 1;
+            int indx = matcher_.indexIn (text.constData(), end, from);
+            if (indx > -1)
+            {
+                if (length)
+                    *length = plen;
+                return indx;
+            }
+            from += CHUNK_SIZE;
+        }
+        return -1;
+    }
+    QRegularExpressionMatchIterator it = regex_.globalMatch (text, from);
+    while (it.hasNext())
+    {
+        if (cancel && cancel->load() != 0)
+            return -1;
+        QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() == 0) // empty matches are useless to us
+            continue;
+        if (length)
+            *length = match.capturedLength();
+        return match.capturedStart();
+    }
+    return -1;
+}
+
+int TextFinder::lastIndexIn (const QString& text, int from, int *length) const
+{
+    if (!isValid() || isRegex_) return -1;
+    const int plen = foldedPattern_.length();
+    int start = qMin (from, text.length() - plen);
+    const QChar *data = text.constData();
+    const QChar *p = foldedPattern_.constData();
+    while (start >= 0)
+    {
+        int i = 0;
+        while (i < plen && foldCase (data[start + i], caseSensitive_) == p[i])
+            ++i;
+        if (i == plen)
+        {
+            if (length)
+                *length = plen;
+            return start;
+        }
+        /* the window is moved back based on its first character */
+        start -= backwardSkip_[foldCase (data[start], caseSensitive_).unicode() & 0xff];
+    }
+    return -1;
+}
+
+QVector<TextMatch> TextFinder::findAll (const QString& text, const QAtomicInt *cancel,
+                                        int maxMatches) const
+{
+    QVector<TextMatch> res;
+    if (!isValid()) return res;
+
+    const QChar *data = text.constData();
+    int line = 0;
+    int lineStart = 0;
+    int scanned = 0; // the position up to which newlines are counted
+    int lineEnd = -1;
+    int from = 0, len = 0;
+    int indx;
+    while ((indx = indexIn (text, from, &len, cancel)) > -1)
+    {
+        if (cancel && cancel->load() != 0)
+            break;
+        for (int i = scanned; i < indx; ++i)
+        {
+            if (data[i] == QLatin1Char ('\n'))
+            {
+                ++line;
+                lineStart = i + 1;
+            }
+        }
+        scanned = indx;
+
+        TextMatch m;
+        m.position = indx;
+        m.length = len;
+        m.line = line;
+        m.column = indx - lineStart;
+        if (lineEnd < indx)
+        {
+            lineEnd = text.indexOf (QLatin1Char ('\n'), indx);
+            if (lineEnd == -1) lineEnd = text.length();
+        }
+        int ctxStart = qMax (lineStart, indx - MAX_CONTEXT / 2);
+        m.context = text.mid (ctxStart, qMin (lineEnd - ctxStart, MAX_CONTEXT));
+        res.append (m);
+        if (maxMatches > 0 && res.size() >= maxMatches)
+            break;
+
+        from = indx + qMax (len, 1);
+    }
+    return res;
+}
+
+}
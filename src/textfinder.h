@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef TEXTFINDER_H
+#define TEXTFINDER_H
+
+#include <QString>
+#include <QStringMatcher>
+#include <QRegularExpression>
+#include <QVector>
+#include <QMetaType>
+#include <QAtomicInt>
+
+namespace fpad {
+
+/* A match found in a flat text buffer (e.g. a document snapshot). */
+struct TextMatch {
+    int position; // in the buffer
+    int length;
+    int line; // zero-based
+    int column; // zero-based
+    QString context; // the line (or a part of it) containing the match
+};
+
+/* The search engine that works on plain strings instead of QTextDocument,
+   so that it can be used in worker threads. Lines are separated by '\n'. */
+class TextFinder
+{
+public:
+    TextFinder (const QString& pattern, bool caseSensitive, bool isRegex);
+
+    bool isValid() const;
+    /* Returns the start of the first match at or after "from"
+       (or -1) and puts its length into "length". A literal search is
+       done in chunks and a regex search checks "cancel" between its
+       matches. Both stop (with -1) if "cancel" becomes nonzero. */
+    int indexIn (const QString& text, int from, int *length,
+                 const QAtomicInt *cancel = nullptr) const;
+    /* Returns the start of the last literal match that starts at or before
+       "from" (or -1) and puts its length into "length". It is found by a
+       reverse Boyer-Moore-Horspool scan with a mirrored skip table. Regex
+       searches are not supported. */
+    int lastIndexIn (const QString& text, int from, int *length) const;
+    /* Finds all matches in "text" and fills their line info too. "cancel" is
+       checked regularly and, if it becomes nonzero, the search is stopped. */
+    QVector<TextMatch> findAll (const QString& text, const QAtomicInt *cancel = nullptr,
+                                int maxMatches = -1) const;
+
+private:
+    QString pattern_;
+    bool caseSensitive_;
+    bool isRegex_;
+    QStringMatcher matcher_;
+    /* for backward literal searches */
+    QString foldedPattern_;
+    int backwardSkip_[256];
+    QRegularExpression regex_;
+};
+
+}
+
+Q_DECLARE_METATYPE (fpad::TextMatch)
+Q_DECLARE_METATYPE (QVector<fpad::TextMatch>)
+
+#endif // TEXTFINDER_H
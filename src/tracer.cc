@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QFile>
+#include <QThread>
+#include <QTimer>
+#include <QCoreApplication>
+#include <algorithm>
+#include "tracer.h"
+
+#define MAX_SAMPLES 1000 // per trace point, for the percentiles
+#define MAX_EVENTS 200000 // for the Chrome trace
+
+namespace fpad {
+
+QAtomicInt Tracer::enabled_ (qEnvironmentVariableIsEmpty ("FPAD_TRACE") ? 0 : 1);
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    qint64 start;
+    qint64 duration;
+    quintptr thread;
+};
+
+struct Samples {
+    Samples() : next (0), count (0) {}
+    QVector<qint64> durations; // a ring buffer
+    int next;
+    qint64 count;
+};
+
+struct TraceData {
+    QMutex mutex;
+    QHash<QByteArray, Samples> samples;
+    QVector<TraceEvent> events;
+};
+
+TraceData &traceData()
+{
+    static TraceData data;
+    return data;
+}
+
+QElapsedTimer startClock()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+const QElapsedTimer traceClock = startClock();
+
+}
+
+void Tracer::setEnabled (bool enabled)
+{
+    enabled_.store (enabled ? 1 : 0);
+}
+
+qint64 Tracer::now()
+{
+    return traceClock.nsecsElapsed();
+}
+
+void Tracer::record (const char *name, qint64 start, qint64 duration)
+{
+    TraceData &data = traceData();
+    const quintptr thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    QMutexLocker locker (&data.mutex);
+    /* no copy of the name, which is a string literal */
+    Samples &samples = data.samples[QByteArray::fromRawData (name, qstrlen (name))];
+    if (samples.durations.size() < MAX_SAMPLES)
+        samples.durations.append (duration);
+    else
+    {
+        samples.durations[samples.next] = duration;
+        samples.next = (samples.next + 1) % MAX_SAMPLES;
+    }
+    ++samples.count;
+
+    if (data.events.size() >= MAX_EVENTS) // keep the newer half
+        data.events.remove (0, MAX_EVENTS / 2);
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.thread = thread;
+    data.events.append (event);
+}
+
+QString Tracer::summary()
+{
+    TraceData &data = traceData();
+    QHash<QByteArray, Samples> samples;
+    {
+        QMutexLocker locker (&data.mutex);
+        samples = data.samples;
+    }
+    QList<QByteArray> names = samples.keys();
+    std::sort (names.begin(), names.end());
+    auto ms = [] (qint64 ns) {
+        return QString::number (static_cast<double>(ns) / 1000000, 'f', 2);
+    };
+    QString str;
+    for (const auto &name : qAsConst (names))
+    {
+        QVector<qint64> d = samples.value (name).durations;
+        if (d.isEmpty()) continue;
+        std::sort (d.begin(), d.end());
+        const int n = d.size();
+        str += QString ("%1  n=%2  p50=%3  p90=%4  p99=%5  max=%6 ms\n")
+               .arg (QString::fromLatin1 (name))
+               .arg (samples.value (name).count)
+               .arg (ms (d.at (n / 2)))
+               .arg (ms (d.at (n * 9 / 10)))
+               .arg (ms (d.at (n * 99 / 100)))
+               .arg (ms (d.last()));
+    }
+    return str.trimmed();
+}
+
+bool Tracer::dump (const QString& fileName)
+{
+    TraceData &data = traceData();
+    QVector<TraceEvent> events;
+    {
+        QMutexLocker locker (&data.mutex);
+        events = data.events;
+    }
+    QFile file (fileName);
+    if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    const QByteArray pid = QByteArray::number (QCoreApplication::applicationPid());
+    QByteArray json ("{\"traceEvents\":[\n");
+    for (int i = 0; i < events.size(); ++i)
+    {
+        const TraceEvent &e = events.at (i);
+        json += "{\"name\":\"" + QByteArray (e.name)
+                + "\",\"ph\":\"X\",\"ts\":" + QByteArray::number (static_cast<double>(e.start) / 1000, 'f', 3)
+                + ",\"dur\":" + QByteArray::number (static_cast<double>(e.duration) / 1000, 'f', 3)
+                + ",\"pid\":" + pid
+                + ",\"tid\":" + QByteArray::number (static_cast<qulonglong>(e.thread))
+                + (i < events.size() - 1 ? "},\n" : "}\n");
+    }
+    json += "]}\n";
+    return file.write (json) == json.size();
+}
+
+TraceOverlay::TraceOverlay (QWidget *parent) : QLabel (parent)
+{
+    setAttribute (Qt::WA_TransparentForMouseEvents);
+    setFont (QFont ("Monospace"));
+    setStyleSheet ("QLabel {background-color: rgba(0, 0, 0, 180); color: #00ff00;"
+                   "border-radius: 3px; padding: 5px;}");
+    QTimer *timer = new QTimer (this);
+    connect (timer, &QTimer::timeout, this, &TraceOverlay::refresh);
+    timer->start (1000);
+    refresh();
+}
+
+void TraceOverlay::setMessage (const QString& message)
+{
+    message_ = message;
+    refresh();
+}
+
+void TraceOverlay::refresh()
+{
+    QString text = Tracer::summary();
+    if (text.isEmpty())
+        text = "Tracing... (Ctrl+Alt+Shift+D writes a Chrome trace)";
+    if (!message_.isEmpty())
+        text = message_ + "\n" + text;
+    setText (text);
+    adjustSize();
+    if (parentWidget())
+        move (parentWidget()->width() - width() - 10, 30);
+    raise();
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QLabel>
+#include <QAtomicInt>
+
+namespace fpad {
+
+/* Records how long the hot paths take, to find where jank comes from.
+   It is enabled by the FPAD_TRACE environment variable or by the hidden
+   shortcut Ctrl+Alt+Shift+T. When it is disabled, a trace point costs
+   only an atomic load. Thread-safe. */
+class Tracer
+{
+public:
+    static bool isEnabled() {
+        return enabled_.load() != 0;
+    }
+    static void setEnabled (bool enabled);
+
+    static qint64 now(); // in nanoseconds
+    static void record (const char *name, qint64 start, qint64 duration);
+    /* One line per trace point with the percentiles of its recent durations. */
+    static QString summary();
+    /* Writes the recorded events in the Chrome trace format
+       (for chrome://tracing or Perfetto). */
+    static bool dump (const QString& fileName);
+
+private:
+    static QAtomicInt enabled_;
+};
+
+/* Times the enclosing scope (-> TRACE_SCOPE). */
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace (const char *name) :
+        name_ (Tracer::isEnabled() ? name : nullptr),
+        start_ (name_ != nullptr ? Tracer::now() : 0) {}
+    ~ScopedTrace() {
+        if (name_ != nullptr)
+            Tracer::record (name_, start_, Tracer::now() - start_);
+    }
+
+private:
+    Q_DISABLE_COPY (ScopedTrace)
+    const char *name_; // a string literal
+    qint64 start_;
+};
+
+#define TRACE_SCOPE(name) fpad::ScopedTrace scopedTrace_ (name)
+
+/* Shows the summary of the tracer over its parent, refreshed every second. */
+class TraceOverlay : public QLabel
+{
+    Q_OBJECT
+public:
+    TraceOverlay (QWidget *parent);
+
+    void setMessage (const QString& message);
+
+private:
+    void refresh();
+
+    QString message_;
+};
+
+}
+
+#endif // TRACER_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014-2020 <tsujan2000@gmail.com>
+ *
+ * fpad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * fpad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include <QTimer>
+#include "textedit.h"
+
+/* The memory budget of the undo/redo histories. QTextDocument doesn't
+   tell how much memory its history takes and can only drop all of it,
+   so the size is estimated from the changed characters and a history is
+   cleared as a whole when it exceeds its budget, or when all histories
+   together exceed the total budget (the largest hidden one goes first).
+   Qt itself merges consecutive typing into one command.
+
+   The largest edit block of a history (e.g., a Replace All in a big file)
+   isn't counted, so that neither it nor the next edit clears the history;
+   the edit that crosses the budget is never the reason for clearing. A
+   clearing loses all undo steps of the tab and is reported by the signal
+   undoHistoryCleared(). */
+
+#define UNDO_COMMAND_COST 64 // bytes; a rough size of an undo command
+#define UNDO_REPORT_STEP 65536 // bytes
+
+namespace fpad {
+
+static qint64 editorBudget = Q_INT64_C (256) << 20;
+static qint64 totalBudget = Q_INT64_C (1024) << 20;
+static qint64 totalBytes = 0;
+
+static QList<TextEdit*> &editors()
+{
+    static QList<TextEdit*> list;
+    return list;
+}
+
+void TextEdit::setUndoBudgets (qint64 perEditor, qint64 total)
+{
+    editorBudget = perEditor;
+    totalBudget = total;
+}
+
+void TextEdit::initUndoBudget()
+{
+    undoBytes_ = undoReported_ = settledBytes_ = largestStep_ = 0;
+    undoing_ = trimPending_ = false;
+    editors().append (this);
+    connect (document(), &QTextDocument::contentsChange, this, [this] (int, int removed, int added) {
+        QTextDocument *doc = document();
+        if (doc->availableUndoSteps() == 0 && doc->availableRedoSteps() == 0)
+            setUndoBytes (0); // the history is cleared, e.g., by setPlainText()
+        else if (!undoing_) // undoing/redoing moves commands between the stacks
+            setUndoBytes (undoBytes_ + (static_cast<qint64>(removed) + added) * 2);
+    });
+    connect (document(), &QTextDocument::undoCommandAdded, this, [this] {
+        setUndoBytes (undoBytes_ + UNDO_COMMAND_COST);
+    });
+}
+
+void TextEdit::releaseUndoBudget()
+{
+    editors().removeAll (this);
+    totalBytes -= undoBytes_;
+}
+
+void TextEdit::setUndoBytes (qint64 bytes)
+{
+    totalBytes += bytes - undoBytes_;
+    undoBytes_ = bytes;
+    if (undoBytes_ == 0)
+        settledBytes_ = largestStep_ = 0;
+    if (qAbs (undoBytes_ - undoReported_) >= UNDO_REPORT_STEP
+        || (undoBytes_ == 0 && undoReported_ != 0))
+    {
+        undoReported_ = undoBytes_;
+        emit undoMemoryChanged (undoBytes_);
+    }
+    /* measure the edit and trim after it is finished */
+    if (!trimPending_ && (undoBytes_ != settledBytes_ || totalBytes > totalBudget))
+    {
+        trimPending_ = true;
+        QTimer::singleShot (0, this, &TextEdit::trimUndo);
+    }
+}
+
+void TextEdit::clearUndoHistory()
+{
+    document()->clearUndoRedoStacks();
+    setUndoBytes (0);
+}
+
+/* Called after an edit is finished. "settledBytes_" is the size of the
+   history before it. */
+void TextEdit::trimUndo()
+{
+    trimPending_ = false;
+    if (isPasting()) return; // its chunks join one edit block (-> pasteStep())
+    largestStep_ = qMax (largestStep_, undoBytes_ - settledBytes_);
+    settledBytes_ = undoBytes_;
+    if (undoBytes_ - largestStep_ > editorBudget)
+    {
+        clearUndoHistory();
+        emit undoHistoryCleared();
+    }
+    /* the histories of the current tabs are kept */
+    while (totalBytes > totalBudget)
+    {
+        TextEdit *largest = nullptr;
+        for (TextEdit *e : qAsConst (editors()))
+        {
+            if (!e->isVisible() && !e->isPasting()
+                && (largest == nullptr || e->undoBytes_ > largest->undoBytes_))
+            {
+                largest = e;
+            }
+        }
+        if (largest == nullptr || largest->undoBytes_ == 0) break;
+        largest->clearUndoHistory();
+        emit largest->undoHistoryCleared();
+    }
+}
+
+}
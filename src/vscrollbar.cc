@@ -19,6 +19,8 @@
 
 #include "vscrollbar.h"
 #include <QApplication>
+#include <QPainter>
+#include <QStyleOptionSlider>
 #if (QT_VERSION != QT_VERSION_CHECK(5,14,0))
 #include <QEvent>
 #endif
@@ -47,6 +49,51 @@ bool VScrollBar::event (QEvent *event)
 
     return QScrollBar::event (event);
 }
+void VScrollBar::setOverview (const QVector<quint8> &marks)
+{
+    if (marks == overview_) return;
+    overview_ = marks;
+    overviewImage_ = QImage();
+    update();
+}
+void VScrollBar::paintEvent (QPaintEvent *event)
+{
+    QScrollBar::paintEvent (event);
+    if (overview_.isEmpty()) return;
+
+    QStyleOptionSlider opt;
+    initStyleOption (&opt);
+    const QRect groove = style()->subControlRect (QStyle::CC_ScrollBar, &opt,
+                                                  QStyle::SC_ScrollBarGroove, this);
+    if (groove.isEmpty()) return;
+    if (overviewImage_.size() != groove.size())
+    { // render the marks once for this size
+        overviewImage_ = QImage (groove.size(), QImage::Format_ARGB32_Premultiplied);
+        overviewImage_.fill (Qt::transparent);
+        QPainter p (&overviewImage_);
+        const int h = groove.height();
+        const int w = groove.width();
+        const int n = overview_.size();
+        for (int y = 0; y < h; ++y)
+        {
+            /* the parts of the document that fall on this pixel row */
+            quint8 marks = 0;
+            const int last = qMax (static_cast<int>(static_cast<qint64>(y + 1) * n / h),
+                                   static_cast<int>(static_cast<qint64>(y) * n / h) + 1);
+            for (int i = static_cast<int>(static_cast<qint64>(y) * n / h); i < last && i < n; ++i)
+                marks |= overview_.at (i);
+            if (marks == 0) continue;
+            if (marks & EditMark)
+                p.fillRect (0, y, w / 3, 2, QColor (0, 160, 0, 200));
+            if (marks & LongLineMark)
+                p.fillRect (w - w / 3, y, w / 3, 2, QColor (200, 0, 0, 200));
+            if (marks & MatchMark)
+                p.fillRect (w / 3, y, w - 2 * (w / 3), 2, QColor (255, 190, 0, 230));
+        }
+    }
+    QPainter painter (this);
+    painter.drawImage (groove.topLeft(), overviewImage_);
+}
 /*************************/
 #if (QT_VERSION == QT_VERSION_CHECK(5,14,0))
 void HScrollBar::wheelEvent (QWheelEvent *event) {
@@ -21,6 +21,7 @@
 #define VSCROLLBAR_H
 
 #include <QScrollBar>
+#include <QImage>
 #if (QT_VERSION == QT_VERSION_CHECK(5,14,0))
 #include <QWheelEvent>
 #endif
@@ -33,11 +34,24 @@ class VScrollBar : public QScrollBar
 public:
     VScrollBar (QWidget *parent = nullptr);
 
+    enum OverviewMark {
+      MatchMark = 1,
+      LongLineMark = 2,
+      EditMark = 4
+    };
+    /* Sets the overview of the document that is shown in the groove.
+       Each item has the OverviewMark flags of an equal part of the
+       document, so painting doesn't depend on the document size. */
+    void setOverview (const QVector<quint8> &marks);
+
 protected:
     bool event (QEvent *event);
+    void paintEvent (QPaintEvent *event);
 
 private:
     int defaultWheelSpeed;
+    QVector<quint8> overview_;
+    QImage overviewImage_; // rendered for the current groove size
 };
 
 #if (QT_VERSION == QT_VERSION_CHECK(5,14,0))